@@ -0,0 +1,36 @@
+#include "lossyLink.h"
+
+#include <algorithm>
+
+LossyLink::LossyLink(UdpSocket& socket, const LinkConditions& conditions, uint64_t seed)
+	: m_socket(socket), m_conditions(conditions), m_rng(seed), m_pending(), m_dropped(0)
+{
+}
+
+void LossyLink::Send(const NetAddress& to, const void* data, size_t size, double nowSecs)
+{
+	if (m_conditions.IsPerfect()) {
+		m_socket.SendTo(to, data, size);
+		return;
+	}
+	if (m_rng.Uniform(0.0, 1.0) < m_conditions.lossRate) {
+		m_dropped++;
+		return;
+	}
+
+	const double delayMs = m_conditions.latencyMs + m_rng.Uniform(0.0, m_conditions.jitterMs);
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	m_pending.push_back({ nowSecs + delayMs * 1e-3, to, std::vector<uint8_t>(bytes, bytes + size) });
+}
+
+void LossyLink::Update(double nowSecs)
+{
+	// Sent in the order they fall due, jitter may swap neighbours like a real network would
+	std::sort(m_pending.begin(), m_pending.end(), [](const Pending& a, const Pending& b) { return a.sendTime < b.sendTime; });
+	size_t due = 0;
+	while (due < m_pending.size() && m_pending[due].sendTime <= nowSecs) {
+		m_socket.SendTo(m_pending[due].to, m_pending[due].data.data(), m_pending[due].data.size());
+		due++;
+	}
+	m_pending.erase(m_pending.begin(), m_pending.begin() + due);
+}
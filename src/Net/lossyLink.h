@@ -0,0 +1,46 @@
+#pragma once
+
+#include "udpSocket.h"
+#include "../Utils/random.h"
+
+#include <vector>
+
+/** Artificial network conditions for testing over loopback */
+struct LinkConditions
+{
+	float latencyMs = 0.f;	// One way
+	float jitterMs = 0.f;	// Uniform extra delay on top of the latency, reorders packets
+	float lossRate = 0.f;	// Share of packets dropped
+
+	inline bool IsPerfect() const { return latencyMs <= 0.f && jitterMs <= 0.f && lossRate <= 0.f; }
+};
+
+/**
+ * Sends through a socket after holding the packets back for the simulated latency, or drops them.
+ * Time is passed in by the caller so a headless run can go faster than real time.
+ */
+class LossyLink
+{
+public:
+	LossyLink(UdpSocket& socket, const LinkConditions& conditions, uint64_t seed);
+
+	void Send(const NetAddress& to, const void* data, size_t size, double nowSecs);
+	/** Sends every held back packet that is due */
+	void Update(double nowSecs);
+
+	inline uint64_t GetDropped() const { return m_dropped; }
+
+private:
+	struct Pending
+	{
+		double sendTime;
+		NetAddress to;
+		std::vector<uint8_t> data;
+	};
+
+	UdpSocket& m_socket;
+	LinkConditions m_conditions;
+	Rng m_rng;
+	std::vector<Pending> m_pending;
+	uint64_t m_dropped;
+};
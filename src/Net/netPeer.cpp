@@ -0,0 +1,50 @@
+#include "netPeer.h"
+#include "../Utils/logger.h"
+
+NetPeer::NetPeer(const NetOptions& options, uint64_t seed, float arenaW, float arenaH, Integrator integrator, float dt)
+	: m_options(options), m_socket(), m_link(m_socket, options.link, seed ^ (options.isHost ? 1 : 2)),
+	m_session(options.isHost, seed, arenaW, arenaH, integrator, dt, options.inputDelay),
+	m_peer(), m_hasPeer(false), m_packet()
+{
+}
+
+bool NetPeer::Open()
+{
+	if (!m_socket.Open(m_options.isHost ? m_options.port : 0))
+		return false;
+	if (m_options.isHost) {
+		GAME_INFO(std::format("Waiting for a client on port {}", m_socket.GetLocalPort()));
+		return true;
+	}
+	if (!UdpSocket::Resolve(m_options.peerHost, m_options.peerPort, m_peer))
+		return false;
+	m_hasPeer = true;
+	GAME_INFO(std::format("Connecting to {}", m_peer.ToString()));
+	return true;
+}
+
+bool NetPeer::Tick(BarControl local, double nowSecs, JobSystem* jobs)
+{
+	uint8_t buf[1024];
+	NetAddress from;
+	int32_t size;
+	while ((size = m_socket.RecvFrom(from, buf, sizeof(buf))) >= 0) {
+		// The host takes the first sender of a valid packet as its client, anything else can't lock it out
+		if (!m_hasPeer && m_session.OnPacket(buf, static_cast<size_t>(size))) {
+			m_peer = from;
+			m_hasPeer = true;
+			GAME_INFO(std::format("Client connected from {}", m_peer.ToString()));
+		} else if (m_hasPeer && from == m_peer) {
+			m_session.OnPacket(buf, static_cast<size_t>(size));
+		}
+	}
+
+	const bool advanced = m_session.Advance(local, jobs);
+
+	if (m_hasPeer) {
+		m_session.BuildPacket(m_packet);
+		m_link.Send(m_peer, m_packet.data(), m_packet.size(), nowSecs);
+	}
+	m_link.Update(nowSecs);
+	return advanced;
+}
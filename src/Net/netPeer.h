@@ -0,0 +1,39 @@
+#pragma once
+
+#include "rollback.h"
+#include "lossyLink.h"
+
+struct NetOptions
+{
+	bool isHost = true;
+	uint16_t port = 0;				// Listening port of the host, the client takes any free one
+	std::string peerHost;			// Where the client connects to
+	uint16_t peerPort = 0;
+	uint32_t inputDelay = 2;		// Ticks
+	LinkConditions link;			// Artificial conditions on everything we send
+};
+
+/** One end of a networked match over UDP, the host learns the client's address from its first packet */
+class NetPeer
+{
+public:
+	NetPeer(const NetOptions& options, uint64_t seed, float arenaW, float arenaH, Integrator integrator, float dt);
+
+	bool Open();
+
+	/** Receives everything waiting, simulates a tick and sends our controls, false if the tick had to wait */
+	bool Tick(BarControl local, double nowSecs, JobSystem* jobs = nullptr);
+
+	inline const RollbackSession& GetSession() const { return m_session; }
+	inline const LossyLink& GetLink() const { return m_link; }
+	inline uint16_t GetLocalPort() const { return m_socket.GetLocalPort(); }
+
+private:
+	NetOptions m_options;
+	UdpSocket m_socket;
+	LossyLink m_link;
+	RollbackSession m_session;
+	NetAddress m_peer;
+	bool m_hasPeer;
+	std::vector<uint8_t> m_packet;
+};
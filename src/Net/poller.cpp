@@ -0,0 +1,127 @@
+#include "poller.h"
+#include "../Utils/logger.h"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#else
+#include <poll.h>
+#endif
+
+// Marks the wake event apart from the sockets
+static constexpr uint64_t s_wakeData = UINT64_MAX;
+
+#ifdef __linux__
+
+Poller::Poller()
+	: m_epoll(epoll_create1(0)), m_wakeFd(eventfd(0, EFD_NONBLOCK))
+{
+	if (m_epoll < 0 || m_wakeFd < 0)
+		GAME_ERROR("Could not create the epoll instance");
+	epoll_event ev{};
+	ev.events = EPOLLIN;
+	ev.data.u64 = s_wakeData;
+	epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeFd, &ev);
+}
+
+Poller::~Poller()
+{
+	close(m_wakeFd);
+	close(m_epoll);
+}
+
+bool Poller::Add(uintptr_t handle, uint64_t userData)
+{
+	epoll_event ev{};
+	ev.events = EPOLLIN;
+	ev.data.u64 = userData;
+	return epoll_ctl(m_epoll, EPOLL_CTL_ADD, static_cast<int>(handle), &ev) == 0;
+}
+
+void Poller::Remove(uintptr_t handle)
+{
+	epoll_ctl(m_epoll, EPOLL_CTL_DEL, static_cast<int>(handle), nullptr);
+}
+
+bool Poller::Wait(int32_t timeoutMs, std::vector<uint64_t>& ready)
+{
+	epoll_event events[256];
+	ready.clear();
+	const int n = epoll_wait(m_epoll, events, 256, timeoutMs);
+	for (int i = 0; i < n; i++) {
+		if (events[i].data.u64 == s_wakeData) {
+			uint64_t count;
+			while (read(m_wakeFd, &count, sizeof(count)) > 0) {}
+			continue;
+		}
+		ready.push_back(events[i].data.u64);
+	}
+	return !ready.empty();
+}
+
+void Poller::Wake()
+{
+	const uint64_t one = 1;
+	// Only fails when the counter is about to overflow, which still leaves it readable
+	[[maybe_unused]] auto written = write(m_wakeFd, &one, sizeof(one));
+}
+
+#else
+
+Poller::Poller()
+	: m_entries(), m_woken(false)
+{
+}
+
+Poller::~Poller()
+{
+}
+
+bool Poller::Add(uintptr_t handle, uint64_t userData)
+{
+	m_entries.push_back({ handle, userData });
+	return true;
+}
+
+void Poller::Remove(uintptr_t handle)
+{
+	std::erase_if(m_entries, [handle](const Entry& e) { return e.handle == handle; });
+}
+
+bool Poller::Wait(int32_t timeoutMs, std::vector<uint64_t>& ready)
+{
+	ready.clear();
+	if (m_woken.exchange(false))
+		timeoutMs = 0;
+
+#ifdef _WIN32
+	std::vector<WSAPOLLFD> fds(m_entries.size());
+	for (size_t i = 0; i < m_entries.size(); i++)
+		fds[i] = { static_cast<SOCKET>(m_entries[i].handle), POLLRDNORM, 0 };
+	const int n = fds.empty() ? 0 : WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), timeoutMs);
+#else
+	std::vector<pollfd> fds(m_entries.size());
+	for (size_t i = 0; i < m_entries.size(); i++)
+		fds[i] = { static_cast<int>(m_entries[i].handle), POLLIN, 0 };
+	const int n = fds.empty() ? 0 : poll(fds.data(), fds.size(), timeoutMs);
+#endif
+	for (size_t i = 0; n > 0 && i < fds.size(); i++) {
+		if (fds[i].revents != 0)
+			ready.push_back(m_entries[i].userData);
+	}
+	return !ready.empty();
+}
+
+void Poller::Wake()
+{
+	m_woken = true;
+}
+
+#endif
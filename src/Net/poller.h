@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Waits until any of many sockets is readable. Backed by epoll on Linux, with an eventfd so another thread can
+ * wake the wait without touching a socket. Elsewhere it falls back to poll, where a wake only ends the timeout early
+ * on the next wait.
+ */
+class Poller
+{
+public:
+	Poller();
+	~Poller();
+
+	Poller(const Poller& other) = delete;
+	Poller& operator=(const Poller& other) = delete;
+
+	bool Add(uintptr_t handle, uint64_t userData);
+	void Remove(uintptr_t handle);
+
+	/** Fills the user data of the readable sockets, returns false if woken or timed out with nothing ready */
+	bool Wait(int32_t timeoutMs, std::vector<uint64_t>& ready);
+
+	/** Callable from any thread, never blocks */
+	void Wake();
+
+private:
+#ifdef __linux__
+	int m_epoll;
+	int m_wakeFd;
+#else
+	struct Entry
+	{
+		uintptr_t handle;
+		uint64_t userData;
+	};
+	std::vector<Entry> m_entries;
+	std::atomic<bool> m_woken;
+#endif
+};
@@ -0,0 +1,192 @@
+#include "rollback.h"
+#include "../Utils/logger.h"
+#include "../Utils/byteOrder.h"
+#include "../Utils/hash.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * Packet layout (little endian): magic "HPNT", u8 flags, u64 seed, u32 ack, u32 sender's tick, i8 sender's advantage,
+ * u32 first tick, u8 count, count controls.
+ * Every packet repeats all the unacknowledged controls, so a lost one is covered by the next.
+ */
+static constexpr char s_magic[4] = { 'H', 'P', 'N', 'T' };
+static constexpr size_t s_headerSize = 4 + 1 + 8 + 4 + 4 + 1 + 4 + 1;
+static constexpr uint8_t s_hostFlag = 1;
+
+RollbackSession::RollbackSession(bool isHost, uint64_t seed, float arenaW, float arenaH, Integrator integrator, float dt, uint32_t inputDelay)
+	: m_isHost(isHost), m_seed(seed), m_arenaW(arenaW), m_arenaH(arenaH), m_integrator(integrator), m_dt(dt), m_sim(),
+	m_tick(0), m_localEnd(std::min(inputDelay, s_maxPrediction)), m_remoteEnd(0), m_peerAck(0), m_rollbackTo(UINT64_MAX),
+	m_remoteTick(0), m_localAdvantages(), m_remoteAdvantages(), m_syncSamples(0), m_nextSync(0), m_syncWait(0),
+	m_localInputs(), m_remoteInputs(), m_remoteTags(), m_usedRemote(), m_states(), m_stats()
+{
+	// The delayed ticks at the start have the bar standing still
+	m_localInputs.fill(Ctrl_Brake);
+	m_remoteInputs.fill(Ctrl_Brake);
+	m_usedRemote.fill(Ctrl_Brake);
+}
+
+void RollbackSession::Start()
+{
+	m_sim = std::make_unique<Simulation>(m_arenaW, m_arenaH, m_seed, m_integrator);
+	m_sim->SetTwoPlayer(true);
+	m_sim->Serve();
+	GAME_INFO(std::format("Network session started with seed {}, playing the {} bar", m_seed, m_isHost ? "left" : "right"));
+}
+
+void RollbackSession::BuildPacket(std::vector<uint8_t>& out) const
+{
+	out.clear();
+	for (char c : s_magic)
+		out.push_back(static_cast<uint8_t>(c));
+	out.push_back(m_isHost ? s_hostFlag : 0);
+	ByteOrder::PutLE(out, m_seed, 8);
+	ByteOrder::PutLE(out, m_remoteEnd, 4);
+	ByteOrder::PutLE(out, m_tick, 4);
+	const float advantage = std::round(this->AverageAdvantage(m_localAdvantages));
+	out.push_back(static_cast<uint8_t>(static_cast<int8_t>(std::clamp(advantage, -127.f, 127.f))));
+
+	// Nothing to send before the peer has answered
+	const uint64_t first = this->IsRunning() ? m_peerAck : m_localEnd;
+	const uint64_t count = std::min<uint64_t>(m_localEnd - first, 255);
+	ByteOrder::PutLE(out, first, 4);
+	out.push_back(static_cast<uint8_t>(count));
+	for (uint64_t t = first; t < first + count; t++)
+		out.push_back(static_cast<uint8_t>(m_localInputs[t % s_historySize]));
+}
+
+bool RollbackSession::OnPacket(const uint8_t* data, size_t size)
+{
+	if (size < s_headerSize || memcmp(data, s_magic, sizeof(s_magic)) != 0)
+		return false;
+	const bool fromHost = (data[4] & s_hostFlag) != 0;
+	if (fromHost == m_isHost)
+		return false;
+	const uint64_t count = data[s_headerSize - 1];
+	if (size < s_headerSize + count)
+		return false;
+
+	if (!this->IsRunning()) {
+		if (fromHost)
+			m_seed = ByteOrder::GetLE(data + 5, 8);
+		this->Start();
+	}
+
+	m_peerAck = std::max(m_peerAck, ByteOrder::GetLE(data + 13, 4));
+	// Reordered packets are late news, only the newest tick is sampled
+	const uint64_t remoteTick = ByteOrder::GetLE(data + 17, 4);
+	if (remoteTick >= m_remoteTick) {
+		m_remoteTick = remoteTick;
+		const size_t slot = m_syncSamples++ % s_syncWindow;
+		m_localAdvantages[slot] = static_cast<int32_t>(static_cast<int64_t>(m_tick) - static_cast<int64_t>(remoteTick));
+		m_remoteAdvantages[slot] = static_cast<int8_t>(data[21]);
+	}
+	const uint64_t first = ByteOrder::GetLE(data + 22, 4);
+	const uint8_t* controls = data + s_headerSize;
+	for (uint64_t i = 0; i < count; i++) {
+		const uint64_t t = first + i;
+		const size_t slot = t % s_historySize;
+		if (t < m_remoteEnd || t >= m_remoteEnd + s_acceptWindow || m_remoteTags[slot] == t + 1 || controls[i] > Ctrl_Down)
+			continue;
+		const BarControl ctrl = static_cast<BarControl>(controls[i]);
+		m_remoteInputs[slot] = ctrl;
+		m_remoteTags[slot] = t + 1;
+		if (t < m_tick && m_usedRemote[slot] != ctrl)
+			m_rollbackTo = std::min(m_rollbackTo, t);
+	}
+	while (m_remoteTags[m_remoteEnd % s_historySize] == m_remoteEnd + 1)
+		m_remoteEnd++;
+	return true;
+}
+
+bool RollbackSession::Advance(BarControl local, JobSystem* jobs)
+{
+	if (!this->IsRunning())
+		return false;
+
+	// Correct the past before going on
+	if (m_rollbackTo < m_tick) {
+		const std::vector<uint64_t>& state = m_states[m_rollbackTo % s_historySize];
+		m_sim->LoadState(state.data(), state.size() * sizeof(uint64_t));
+		const uint64_t depth = m_tick - m_rollbackTo;
+		for (uint64_t t = m_rollbackTo; t < m_tick; t++)
+			this->SimulateTick(t, jobs);
+		m_stats.rollbacks++;
+		m_stats.resimulatedTicks += depth;
+		m_stats.maxRollback = std::max(m_stats.maxRollback, static_cast<uint32_t>(depth));
+	}
+	m_rollbackTo = UINT64_MAX;
+
+	// Give a peer that fell behind a tick or two now and then to catch up
+	if (m_tick >= m_nextSync) {
+		m_nextSync = m_tick + s_syncInterval;
+		m_syncWait = static_cast<uint32_t>(std::clamp(std::round(this->GetFrameAdvantage()), 0.f, static_cast<float>(s_maxSyncWait)));
+	}
+	if (m_syncWait > 0) {
+		m_syncWait--;
+		m_stats.syncWaits++;
+		return false;
+	}
+
+	// Wait if the guesses would go too far, or the peer is missing controls we would soon overwrite
+	if (m_tick >= m_remoteEnd + s_maxPrediction || m_localEnd + 1 >= m_peerAck + s_historySize) {
+		m_stats.stalledTicks++;
+		return false;
+	}
+
+	m_localInputs[m_localEnd % s_historySize] = local;
+	m_localEnd++;
+	this->SimulateTick(m_tick, jobs);
+	m_tick++;
+	return true;
+}
+
+void RollbackSession::SimulateTick(uint64_t tick, JobSystem* jobs)
+{
+	const size_t slot = tick % s_historySize;
+	m_sim->SaveState(m_states[slot]);
+
+	// Guess that the remote player still holds the last control we know of
+	BarControl remote = Ctrl_Brake;
+	if (m_remoteTags[slot] == tick + 1)
+		remote = m_remoteInputs[slot];
+	else if (m_remoteEnd > 0)
+		remote = m_remoteInputs[(m_remoteEnd - 1) % s_historySize];
+	m_usedRemote[slot] = remote;
+
+	TickInput input;
+	input.left = m_isHost ? m_localInputs[slot] : remote;
+	input.right = m_isHost ? remote : m_localInputs[slot];
+	const SimEvents ev = m_sim->Step(input, m_dt, jobs);
+	if (ev.leftMiss || ev.rightMiss || ev.captured)
+		m_sim->Serve();
+}
+
+float RollbackSession::GetFrameAdvantage() const
+{
+	// Our sample is the real lead plus the trip time, the peer's is minus the lead plus the trip time
+	return 0.5f * (this->AverageAdvantage(m_localAdvantages) - this->AverageAdvantage(m_remoteAdvantages));
+}
+
+float RollbackSession::AverageAdvantage(const std::array<int32_t, s_syncWindow>& samples) const
+{
+	const uint64_t count = std::min<uint64_t>(m_syncSamples, s_syncWindow);
+	if (count == 0)
+		return 0.f;
+	int64_t sum = 0;
+	for (uint64_t i = 0; i < count; i++)
+		sum += samples[i];
+	return static_cast<float>(sum) / static_cast<float>(count);
+}
+
+bool RollbackSession::GetConfirmedChecksum(uint64_t tick, uint64_t& out) const
+{
+	if (tick >= m_tick || tick > m_remoteEnd || tick + s_historySize <= m_tick || m_rollbackTo < tick)
+		return false;
+
+	// Over the snapshot's bytes, the words are little endian on every supported platform
+	const std::vector<uint64_t>& words = m_states[tick % s_historySize];
+	out = Hash::Fnv1a(std::string_view(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint64_t)));
+	return true;
+}
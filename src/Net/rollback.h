@@ -0,0 +1,92 @@
+#pragma once
+
+#include "../simulation.h"
+
+#include <memory>
+
+struct RollbackStats
+{
+	uint64_t rollbacks = 0;
+	uint64_t resimulatedTicks = 0;
+	uint64_t stalledTicks = 0;		// Ticks waited for the peer because the prediction went too far
+	uint64_t syncWaits = 0;			// Ticks skipped to let the peer catch up
+	uint32_t maxRollback = 0;
+};
+
+/**
+ * Two player session kept in sync by exchanging only bar controls, GGPO style.
+ * The local control is applied after the input delay, the remote one is predicted to stay the same until it arrives.
+ * A wrong guess loads the snapshot from the start of that tick and simulates up to the present again.
+ * Both peers report how far ahead they see themselves, and the one really ahead skips a tick now and then,
+ * so the rollbacks are split evenly at about half the round trip each.
+ * The host plays the left bar and decides the seed, the transport is up to the caller.
+ */
+class RollbackSession
+{
+public:
+	RollbackSession(bool isHost, uint64_t seed, float arenaW, float arenaH, Integrator integrator, float dt, uint32_t inputDelay = 2);
+
+	inline bool IsRunning() const { return m_sim != nullptr; }
+	inline bool IsHost() const { return m_isHost; }
+
+	/** Handshake until the peer is heard from, then every local control the peer hasn't acknowledged */
+	void BuildPacket(std::vector<uint8_t>& out) const;
+	/** False if it isn't a packet from the other side of a session */
+	bool OnPacket(const uint8_t* data, size_t size);
+
+	/** Queues the local control and simulates one tick, false if still waiting for the peer */
+	bool Advance(BarControl local, JobSystem* jobs = nullptr);
+
+	inline const Simulation& GetSim() const { return *m_sim; }
+	inline uint64_t GetTick() const { return m_tick; }
+	inline uint64_t GetSeed() const { return m_seed; }
+	inline const RollbackStats& GetStats() const { return m_stats; }
+	/** Ticks we're ahead of the peer, from both sides' averaged view so the latency cancels out */
+	float GetFrameAdvantage() const;
+
+	/** Hash of the state at the start of the tick, only given once all the inputs before it are confirmed */
+	bool GetConfirmedChecksum(uint64_t tick, uint64_t& out) const;
+
+	static constexpr uint32_t s_maxPrediction = 32;		// Ticks to run ahead of the last confirmed remote control
+
+private:
+	static constexpr uint32_t s_historySize = 128;		// Ticks of inputs and snapshots kept, well over the prediction window
+	static constexpr uint32_t s_acceptWindow = 64;		// How far past the confirmed ones remote controls are taken
+	static constexpr uint32_t s_syncWindow = 32;		// Advantage samples averaged
+	static constexpr uint32_t s_syncInterval = 32;		// Ticks between time sync checks, so the averages see the last wait
+	static constexpr uint32_t s_maxSyncWait = 2;		// Ticks skipped at most per check
+
+	bool m_isHost;
+	uint64_t m_seed;
+	float m_arenaW, m_arenaH;
+	Integrator m_integrator;
+	float m_dt;
+	std::unique_ptr<Simulation> m_sim;
+
+	uint64_t m_tick;			// Next tick to simulate
+	uint64_t m_localEnd;		// Local controls are known for the ticks before this
+	uint64_t m_remoteEnd;		// Remote controls are confirmed for the ticks before this
+	uint64_t m_peerAck;			// The peer has our controls for the ticks before this
+	uint64_t m_rollbackTo;		// First tick simulated with a wrong guess, UINT64_MAX if none
+	uint64_t m_remoteTick;		// Latest tick the peer said it was at
+
+	// Time sync, the local samples are our tick minus the peer's, the remote ones what the peer reported
+	std::array<int32_t, s_syncWindow> m_localAdvantages;
+	std::array<int32_t, s_syncWindow> m_remoteAdvantages;
+	uint64_t m_syncSamples;
+	uint64_t m_nextSync;
+	uint32_t m_syncWait;		// Ticks still to skip
+
+	// Indexed by tick modulo the history size
+	std::array<BarControl, s_historySize> m_localInputs;
+	std::array<BarControl, s_historySize> m_remoteInputs;
+	std::array<uint64_t, s_historySize> m_remoteTags;		// Tick + 1 of the remote control in the slot, 0 if none
+	std::array<BarControl, s_historySize> m_usedRemote;		// What the simulation went with, guessed or not
+	std::array<std::vector<uint64_t>, s_historySize> m_states;
+
+	RollbackStats m_stats;
+private:
+	void Start();
+	void SimulateTick(uint64_t tick, JobSystem* jobs);
+	float AverageAdvantage(const std::array<int32_t, s_syncWindow>& samples) const;
+};
@@ -0,0 +1,364 @@
+#include "spectator.h"
+#include "stateDelta.h"
+#include "../simulation.h"
+#include "../simState.h"
+#include "../Utils/logger.h"
+#include "../Utils/byteOrder.h"
+#include "../Utils/hash.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace SpectatorProtocol;
+
+static constexpr size_t s_headerSize = 4 + 1 + 4 + 4;
+static const std::vector<uint64_t> s_emptyBase;
+
+static bool CheckMagic(const uint8_t* data, size_t size, PacketType type)
+{
+	return size >= 5 && memcmp(data, s_magic, sizeof(s_magic)) == 0 && data[4] == type;
+}
+
+static double SecsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// *** SpectatorServer *** //
+
+SpectatorServer::SpectatorServer()
+	: m_socket(), m_poller(), m_states(), m_thread(), m_stop(false), m_ticksPerSend(1),
+	m_clients(), m_history(), m_historyNext(0), m_lastSentTick(UINT64_MAX), m_encoded(), m_secret(0), m_lastFullWarn(-1e9),
+	m_clientCount(0), m_packetsSent(0), m_bytesSent(0), m_fullSends(0), m_sendFailures(0)
+{
+}
+
+SpectatorServer::~SpectatorServer()
+{
+	this->Stop();
+}
+
+bool SpectatorServer::Start(uint16_t port, uint32_t ticksPerSend)
+{
+	if (!m_socket.Open(port) || !m_poller.Add(m_socket.GetHandle(), 0))
+		return false;
+	m_ticksPerSend = std::max(ticksPerSend, 1u);
+	std::random_device rd;
+	m_secret = (static_cast<uint64_t>(rd()) << 32) | rd();
+	m_stop = false;
+	m_thread = std::thread(&SpectatorServer::Run, this);
+	GAME_INFO(std::format("Spectator server listening on port {}", m_socket.GetLocalPort()));
+	return true;
+}
+
+void SpectatorServer::Stop()
+{
+	if (!m_thread.joinable())
+		return;
+	m_stop = true;
+	m_poller.Wake();
+	m_thread.join();
+	m_socket.Close();
+}
+
+void SpectatorServer::Publish(const Simulation& sim)
+{
+	sim.SaveState(m_states.GetBack());
+	m_states.Publish();
+	// The server thread only cares about the ticks it sends
+	if (sim.GetTick() % m_ticksPerSend == 0)
+		m_poller.Wake();
+}
+
+void SpectatorServer::Run()
+{
+	const auto start = std::chrono::steady_clock::now();
+	std::vector<uint64_t> ready;
+	double lastEviction = 0.0;
+
+	while (!m_stop) {
+		m_poller.Wait(100, ready);
+		const double now = SecsSince(start);
+		this->ReadPackets(now);
+
+		if (m_states.Acquire()) {
+			const std::vector<uint64_t>& state = m_states.GetFront();
+			const uint64_t tick = reinterpret_cast<const SimState::Header*>(state.data())->tick;
+			if (m_lastSentTick == UINT64_MAX || tick >= m_lastSentTick + m_ticksPerSend || tick < m_lastSentTick) {
+				this->Broadcast(state);
+				m_lastSentTick = tick;
+			}
+		}
+
+		if (now - lastEviction > 1.0) {
+			std::erase_if(m_clients, [now](const auto& c) { return now - c.second.lastHeard > s_clientTimeout; });
+			m_clientCount.store(static_cast<uint32_t>(m_clients.size()), std::memory_order_relaxed);
+			lastEviction = now;
+		}
+	}
+}
+
+void SpectatorServer::ReadPackets(double now)
+{
+	uint8_t buf[64];
+	NetAddress from;
+	int32_t size;
+	while ((size = m_socket.RecvFrom(from, buf, sizeof(buf))) >= 0) {
+		const uint64_t key = (static_cast<uint64_t>(from.ip) << 16) | from.port;
+		const uint64_t token = this->GetToken(from);
+		if (CheckMagic(buf, size, Pt_Ack) && size >= 17) {
+			// Only whoever really is at the address gets the token to answer with
+			if (ByteOrder::GetLE(buf + 9, 8) != token) {
+				std::vector<uint8_t> welcome = { 'H', 'P', 'S', 'P', Pt_Welcome };
+				ByteOrder::PutLE(welcome, token, 8);
+				m_socket.SendTo(from, welcome.data(), welcome.size());
+				continue;
+			}
+			auto it = m_clients.find(key);
+			if (it == m_clients.end()) {
+				if (m_clients.size() >= s_maxClients) {
+					if (now - m_lastFullWarn > s_clientTimeout) {
+						GAME_WARN(std::format("Spectator server is full with {} clients, turned away {}", m_clients.size(), from.ToString()));
+						m_lastFullWarn = now;
+					}
+					continue;
+				}
+				it = m_clients.emplace(key, Client{ from }).first;
+			}
+			it->second.ackTick = static_cast<uint32_t>(ByteOrder::GetLE(buf + 5, 4));
+			it->second.lastHeard = now;
+		} else if (CheckMagic(buf, size, Pt_Leave) && size >= 13 && ByteOrder::GetLE(buf + 5, 8) == token) {
+			m_clients.erase(key);
+		}
+	}
+	m_clientCount.store(static_cast<uint32_t>(m_clients.size()), std::memory_order_relaxed);
+}
+
+uint64_t SpectatorServer::GetToken(const NetAddress& addr) const
+{
+	std::vector<uint8_t> bytes;
+	ByteOrder::PutLE(bytes, m_secret, 8);
+	ByteOrder::PutLE(bytes, addr.ip, 4);
+	ByteOrder::PutLE(bytes, addr.port, 2);
+	// 0 is what a client sends before its welcome
+	return std::max<uint64_t>(Hash::Fnv1a(std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size())), 1);
+}
+
+const SpectatorServer::SentState* SpectatorServer::FindSent(uint32_t tick) const
+{
+	if (tick == s_noTick)
+		return nullptr;
+	for (const SentState& s : m_history) {
+		if (s.tick == tick)
+			return &s;
+	}
+	return nullptr;
+}
+
+void SpectatorServer::Broadcast(const std::vector<uint64_t>& state)
+{
+	SentState& cur = m_history[m_historyNext++ % s_history];
+	cur.tick = static_cast<uint32_t>(reinterpret_cast<const SimState::Header*>(state.data())->tick);
+	cur.words = state;
+
+	// Clients mostly share the same base, each distinct one is encoded once per send
+	m_encoded.clear();
+	for (const auto& [key, client] : m_clients) {
+		const SentState* base = client.ackTick != cur.tick ? this->FindSent(client.ackTick) : nullptr;
+		const uint32_t baseTick = base ? base->tick : s_noTick;
+
+		auto it = std::find_if(m_encoded.begin(), m_encoded.end(), [baseTick](const Encoded& e) { return e.baseTick == baseTick; });
+		if (it == m_encoded.end()) {
+			Encoded& enc = m_encoded.emplace_back(Encoded{ baseTick, {} });
+			for (char c : s_magic)
+				enc.packet.push_back(static_cast<uint8_t>(c));
+			enc.packet.push_back(Pt_State);
+			ByteOrder::PutLE(enc.packet, cur.tick, 4);
+			ByteOrder::PutLE(enc.packet, baseTick, 4);
+			StateDelta::Encode(base ? base->words : s_emptyBase, cur.words, enc.packet);
+			it = m_encoded.end() - 1;
+		}
+
+		// Non-blocking, a full socket buffer drops the packet and the next delta covers for it
+		if (m_socket.SendTo(client.addr, it->packet.data(), it->packet.size())) {
+			m_packetsSent.fetch_add(1, std::memory_order_relaxed);
+			m_bytesSent.fetch_add(it->packet.size(), std::memory_order_relaxed);
+			if (!base)
+				m_fullSends.fetch_add(1, std::memory_order_relaxed);
+		} else {
+			m_sendFailures.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+}
+
+// *** SpectatorClient *** //
+
+SpectatorClient::SpectatorClient()
+	: m_socket(), m_server(), m_tickSecs(1.f), m_delaySecs(0.f), m_states(), m_newest(0),
+	m_lastAck(-1e9), m_token(0), m_received(0), m_decodeFailures(0), m_decoded()
+{
+}
+
+SpectatorClient::~SpectatorClient()
+{
+	this->Close();
+}
+
+bool SpectatorClient::Open(const NetAddress& server, float tickSecs, float delaySecs)
+{
+	if (!m_socket.Open(0))
+		return false;
+	m_server = server;
+	m_tickSecs = tickSecs;
+	m_delaySecs = delaySecs;
+	return true;
+}
+
+void SpectatorClient::Close()
+{
+	if (!m_socket.IsOpen())
+		return;
+	std::vector<uint8_t> leave = { 'H', 'P', 'S', 'P', Pt_Leave };
+	ByteOrder::PutLE(leave, m_token, 8);
+	m_socket.SendTo(m_server, leave.data(), leave.size());
+	m_socket.Close();
+}
+
+void SpectatorClient::SendAck(uint32_t tick)
+{
+	std::vector<uint8_t> ack = { 'H', 'P', 'S', 'P', Pt_Ack };
+	ByteOrder::PutLE(ack, tick, 4);
+	ByteOrder::PutLE(ack, m_token, 8);
+	m_socket.SendTo(m_server, ack.data(), ack.size());
+}
+
+const SpectatorClient::State* SpectatorClient::FindState(uint32_t tick) const
+{
+	for (const State& s : m_states) {
+		if (s.tick == tick)
+			return &s;
+	}
+	return nullptr;
+}
+
+void SpectatorClient::Poll(double nowSecs)
+{
+	uint8_t buf[65536];
+	NetAddress from;
+	int32_t size;
+	bool gotNew = false;
+	bool welcomed = false;
+	while ((size = m_socket.RecvFrom(from, buf, sizeof(buf))) >= 0) {
+		if (!(from == m_server))
+			continue;
+		if (CheckMagic(buf, size, Pt_Welcome) && size >= 13) {
+			m_token = ByteOrder::GetLE(buf + 5, 8);
+			welcomed = true;
+			continue;
+		}
+		if (!CheckMagic(buf, size, Pt_State) || static_cast<size_t>(size) < s_headerSize)
+			continue;
+		const uint32_t tick = static_cast<uint32_t>(ByteOrder::GetLE(buf + 5, 4)), baseTick = static_cast<uint32_t>(ByteOrder::GetLE(buf + 9, 4));
+		// Late packets are of no use once something newer has been rebuilt
+		if (m_received > 0 && tick <= m_states[m_newest].tick)
+			continue;
+
+		const State* base = this->FindState(baseTick);
+		if ((baseTick != s_noTick && !base) || !StateDelta::Decode(base ? base->words : s_emptyBase, buf + s_headerSize, size - s_headerSize, m_decoded)) {
+			m_decodeFailures++;
+			continue;
+		}
+		// The game always has a dot in play, a state without one is broken and the renderer can't draw it
+		const SimState::Header* header = SimState::View(m_decoded.data(), m_decoded.size() * sizeof(uint64_t));
+		if (!header || header->dotCount == 0) {
+			m_decodeFailures++;
+			continue;
+		}
+
+		m_newest = m_received > 0 ? (m_newest + 1) % s_history : 0;
+		State& s = m_states[m_newest];
+		s.tick = tick;
+		s.arrival = nowSecs;
+		s.words.swap(m_decoded);
+		m_received++;
+		gotNew = true;
+	}
+
+	// Acks are rationed, the server can delta against any of the recent states. A welcome is answered right away
+	if (welcomed) {
+		this->SendAck(m_received > 0 ? m_states[m_newest].tick : s_noTick);
+		m_lastAck = nowSecs;
+	} else if (gotNew && nowSecs - m_lastAck >= s_ackInterval) {
+		this->SendAck(m_states[m_newest].tick);
+		m_lastAck = nowSecs;
+	} else if (m_received == 0 && nowSecs - m_lastAck > s_helloInterval) {
+		this->SendAck(s_noTick);
+		m_lastAck = nowSecs;
+	}
+}
+
+bool SpectatorClient::Sample(double nowSecs, GameSnapshot& out) const
+{
+	if (m_received == 0)
+		return false;
+
+	// Play back a little behind the newest state so there is usually a later one to interpolate towards
+	const State& newest = m_states[m_newest];
+	const double viewTick = newest.tick + (nowSecs - newest.arrival - m_delaySecs) / m_tickSecs;
+	const State* a = nullptr;
+	const State* b = nullptr;
+	for (const State& s : m_states) {
+		if (s.tick == s_noTick)
+			continue;
+		if (s.tick <= viewTick && (!a || s.tick > a->tick))
+			a = &s;
+		if (s.tick > viewTick && (!b || s.tick < b->tick))
+			b = &s;
+	}
+	if (!a) {
+		a = b;
+		b = nullptr;
+	}
+
+	const SimState::Header* ha = SimState::View(a->words.data(), a->words.size() * sizeof(uint64_t));
+	const SimState::Header* hb = b ? SimState::View(b->words.data(), b->words.size() * sizeof(uint64_t)) : nullptr;
+	const float t = hb ? static_cast<float>((viewTick - a->tick) / (b->tick - a->tick)) : 0.0f;
+	// A new serve teleports the dot, that shouldn't be smeared across the arena
+	if (hb && hb->dotCount != ha->dotCount)
+		hb = nullptr;
+
+	out.tick = static_cast<uint64_t>(std::max(viewTick, 0.0));
+	out.simTime = static_cast<float>(viewTick * m_tickSecs);
+	const SimState::Dot* dotsA = SimState::GetDots(ha);
+	const SimState::Dot* dotsB = hb ? SimState::GetDots(hb) : nullptr;
+	out.dots.resize(ha->dotCount);
+	for (uint32_t i = 0; i < ha->dotCount; i++) {
+		DotState d{ Vec2(dotsA[i].pos), Vec2(dotsA[i].vel) };
+		if (dotsB) {
+			const Vec2 posB(dotsB[i].pos);
+			if ((posB - d.pos).lengthSqr() < 200.f * 200.f) {
+				d.pos = d.pos + (posB - d.pos) * t;
+				d.vel = d.vel + (Vec2(dotsB[i].vel) - d.vel) * t;
+			}
+		}
+		out.dots[i] = d;
+	}
+
+	const SimState::Well* wells = SimState::GetWells(ha);
+	out.wells.resize(ha->wellCount);
+	for (uint32_t i = 0; i < ha->wellCount; i++)
+		out.wells[i] = { Vec2(wells[i].pos), wells[i].mass, wells[i].drawRad };
+
+	auto lerpBar = [t, hb](const SimState::Bar& barA, const SimState::Bar* barB, bool isLeft) {
+		BarState bar{ barA.yPos, barA.yVel, isLeft };
+		if (hb) {
+			bar.yPos += (barB->yPos - barA.yPos) * t;
+			bar.yVel += (barB->yVel - barA.yVel) * t;
+		}
+		return bar;
+	};
+	out.leftBar = lerpBar(ha->leftBar, hb ? &hb->leftBar : nullptr, true);
+	out.rightBar = lerpBar(ha->rightBar, hb ? &hb->rightBar : nullptr, false);
+	out.isTwoPlayer = ha->isTwoPlayer != 0;
+	return true;
+}
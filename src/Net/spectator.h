@@ -0,0 +1,150 @@
+#pragma once
+
+#include "udpSocket.h"
+#include "poller.h"
+#include "../Utils/tripleBuffer.h"
+#include "../gameState.h"
+
+#include <thread>
+
+class Simulation;
+
+/**
+ * Spectator stream over UDP. Packets (little endian) start with magic "HPSP" and a u8 type:
+ * state: u32 tick, u32 base tick (all ones for none), StateDelta of the snapshot against the base.
+ * ack: u32 newest tick the client has rebuilt, all ones for a hello before anything arrived, u64 token. leave: u64 token.
+ * welcome: u64 token, the server's answer to an ack without the right token for its address.
+ * A client is only admitted once it echoes the token, so a forged source address can't join.
+ * The server deltas against the newest state each client has acknowledged, so a lost packet only costs bandwidth.
+ */
+namespace SpectatorProtocol {
+	constexpr char s_magic[4] = { 'H', 'P', 'S', 'P' };
+	constexpr uint32_t s_noTick = UINT32_MAX;
+	constexpr size_t s_history = 32;	// Sent states kept as delta bases
+
+	enum PacketType : uint8_t
+	{
+		Pt_State = 1,
+		Pt_Ack,
+		Pt_Leave,
+		Pt_Welcome
+	};
+}
+
+/** Fans the game state out to spectators from its own thread, the game thread only ever copies into a triple buffer */
+class SpectatorServer
+{
+public:
+	SpectatorServer();
+	~SpectatorServer();
+
+	SpectatorServer(const SpectatorServer& other) = delete;
+	SpectatorServer& operator=(const SpectatorServer& other) = delete;
+
+	/** Sends every ticksPerSend:th tick */
+	bool Start(uint16_t port, uint32_t ticksPerSend);
+	void Stop();
+
+	/** Called by the game thread after every tick, never waits on the network */
+	void Publish(const Simulation& sim);
+
+	inline uint16_t GetPort() const { return m_socket.GetLocalPort(); }
+	inline uint32_t GetClientCount() const { return m_clientCount.load(std::memory_order_relaxed); }
+	inline uint64_t GetPacketsSent() const { return m_packetsSent.load(std::memory_order_relaxed); }
+	inline uint64_t GetBytesSent() const { return m_bytesSent.load(std::memory_order_relaxed); }
+	inline uint64_t GetFullSends() const { return m_fullSends.load(std::memory_order_relaxed); }
+	inline uint64_t GetSendFailures() const { return m_sendFailures.load(std::memory_order_relaxed); }
+
+	static constexpr uint32_t s_maxClients = 256;	// Admitted at once, the rest are turned away
+
+private:
+	struct Client
+	{
+		NetAddress addr;
+		uint32_t ackTick = SpectatorProtocol::s_noTick;
+		double lastHeard = 0.0;
+	};
+	struct SentState
+	{
+		uint32_t tick = SpectatorProtocol::s_noTick;
+		std::vector<uint64_t> words;
+	};
+	struct Encoded
+	{
+		uint32_t baseTick;
+		std::vector<uint8_t> packet;
+	};
+
+	UdpSocket m_socket;
+	Poller m_poller;
+	TripleBuffer<std::vector<uint64_t>> m_states;	// Game thread writes, server thread reads
+	std::thread m_thread;
+	std::atomic<bool> m_stop;
+	uint32_t m_ticksPerSend;
+
+	// * Server thread only *
+	std::unordered_map<uint64_t, Client> m_clients;		// By address
+	std::array<SentState, SpectatorProtocol::s_history> m_history;
+	size_t m_historyNext;
+	uint64_t m_lastSentTick;
+	std::vector<Encoded> m_encoded;		// One packet per base tick in use, reused across the clients of a send
+	uint64_t m_secret;					// Keys the join tokens, new for every Start
+	double m_lastFullWarn;
+
+	std::atomic<uint32_t> m_clientCount;
+	std::atomic<uint64_t> m_packetsSent, m_bytesSent, m_fullSends, m_sendFailures;
+
+	static constexpr double s_clientTimeout = 5.0;	// Seconds without an ack before a client is dropped
+private:
+	void Run();
+	void ReadPackets(double now);
+	uint64_t GetToken(const NetAddress& addr) const;
+	void Broadcast(const std::vector<uint64_t>& state);
+	const SentState* FindSent(uint32_t tick) const;
+};
+
+/** Receives the spectator stream and interpolates between the states for drawing */
+class SpectatorClient
+{
+public:
+	SpectatorClient();
+	~SpectatorClient();
+
+	/** tickSecs is the simulation tick length, delaySecs how far behind the newest state the view is kept to hide jitter */
+	bool Open(const NetAddress& server, float tickSecs, float delaySecs = 0.05f);
+	/** Sends a leave so the server can forget us right away */
+	void Close();
+
+	/** Reads every waiting packet and acknowledges new states, says hello until the first state arrives */
+	void Poll(double nowSecs);
+	/** The view at the time, false until the first state has arrived */
+	bool Sample(double nowSecs, GameSnapshot& out) const;
+
+	inline uintptr_t GetHandle() const { return m_socket.GetHandle(); }
+	inline uint64_t GetReceived() const { return m_received; }
+	inline uint64_t GetDecodeFailures() const { return m_decodeFailures; }
+
+private:
+	struct State
+	{
+		uint32_t tick = SpectatorProtocol::s_noTick;
+		double arrival = 0.0;
+		std::vector<uint64_t> words;
+	};
+
+	UdpSocket m_socket;
+	NetAddress m_server;
+	float m_tickSecs, m_delaySecs;
+	std::array<State, SpectatorProtocol::s_history> m_states;
+	size_t m_newest;
+	double m_lastAck;
+	uint64_t m_token;		// From the server's welcome, 0 until then
+	uint64_t m_received, m_decodeFailures;
+	std::vector<uint64_t> m_decoded;
+
+	static constexpr double s_ackInterval = 0.05;
+	static constexpr double s_helloInterval = 0.5;
+private:
+	void SendAck(uint32_t tick);
+	const State* FindState(uint32_t tick) const;
+};
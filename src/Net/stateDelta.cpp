@@ -0,0 +1,54 @@
+#include "stateDelta.h"
+#include "../Utils/byteOrder.h"
+
+// Snapshots are tiny, this keeps a corrupt count from allocating much
+static constexpr size_t s_maxWords = 8192;
+
+void StateDelta::Encode(const std::vector<uint64_t>& base, const std::vector<uint64_t>& cur, std::vector<uint8_t>& out)
+{
+	const size_t words = cur.size();
+	ByteOrder::PutLE(out, words, 2);
+
+	for (size_t group = 0; group < words; group += 8) {
+		const size_t maskPos = out.size();
+		out.push_back(0);
+		uint8_t mask = 0;
+		for (size_t i = group; i < words && i < group + 8; i++) {
+			const uint64_t diff = cur[i] ^ (i < base.size() ? base[i] : 0);
+			if (diff == 0)
+				continue;
+			mask |= static_cast<uint8_t>(1 << (i - group));
+			ByteOrder::PutLE(out, diff, 8);
+		}
+		out[maskPos] = mask;
+	}
+}
+
+bool StateDelta::Decode(const std::vector<uint64_t>& base, const uint8_t* data, size_t size, std::vector<uint64_t>& out)
+{
+	if (size < 2)
+		return false;
+	const size_t words = static_cast<size_t>(ByteOrder::GetLE(data, 2));
+	if (words > s_maxWords)
+		return false;
+
+	out.resize(words);
+	for (size_t i = 0; i < words; i++)
+		out[i] = i < base.size() ? base[i] : 0;
+
+	size_t pos = 2;
+	for (size_t group = 0; group < words; group += 8) {
+		if (pos >= size)
+			return false;
+		const uint8_t mask = data[pos++];
+		for (size_t i = group; i < words && i < group + 8; i++) {
+			if ((mask & (1 << (i - group))) == 0)
+				continue;
+			if (pos + 8 > size)
+				return false;
+			out[i] ^= ByteOrder::GetLE(data + pos, 8);
+			pos += 8;
+		}
+	}
+	return pos == size;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Delta coding of SimState snapshots held as 64 bit words.
+ * Layout: u16 word count, then for every 8 words a mask byte of the ones that changed followed by those words
+ * XORed with the base. Words past the end of the base count as zero, so an empty base gives a full snapshot.
+ */
+namespace StateDelta {
+	/** Appends the delta of cur against base to out */
+	void Encode(const std::vector<uint64_t>& base, const std::vector<uint64_t>& cur, std::vector<uint8_t>& out);
+	/** Rebuilds the snapshot into out, false if the data is cut short or malformed */
+	bool Decode(const std::vector<uint64_t>& base, const uint8_t* data, size_t size, std::vector<uint64_t>& out);
+}
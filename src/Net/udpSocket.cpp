@@ -0,0 +1,146 @@
+#include "udpSocket.h"
+#include "../Utils/logger.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int SOCKET;
+#endif
+
+#ifdef _WIN32
+static bool InitSockets()
+{
+	// Winsock needs to be started once per process
+	static const bool ok = []() {
+		WSADATA data;
+		return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+	}();
+	return ok;
+}
+#endif
+
+std::string NetAddress::ToString() const
+{
+	return std::format("{}.{}.{}.{}:{}", (ip >> 24) & 0xff, (ip >> 16) & 0xff, (ip >> 8) & 0xff, ip & 0xff, port);
+}
+
+UdpSocket::UdpSocket()
+	: m_socket(s_invalid)
+{
+}
+
+UdpSocket::~UdpSocket()
+{
+	this->Close();
+}
+
+bool UdpSocket::Open(uint16_t port)
+{
+	this->Close();
+#ifdef _WIN32
+	if (!InitSockets())
+		return false;
+	SOCKET s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (s == INVALID_SOCKET) {
+		GAME_ERROR("Could not create an UDP socket");
+		return false;
+	}
+	u_long nonBlocking = 1;
+	ioctlsocket(s, FIONBIO, &nonBlocking);
+#else
+	SOCKET s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (s < 0) {
+		GAME_ERROR("Could not create an UDP socket");
+		return false;
+	}
+	fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+	m_socket = static_cast<uintptr_t>(s);
+
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	if (bind(s, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+		GAME_ERROR(std::format("Could not bind an UDP socket to port {}", port));
+		this->Close();
+		return false;
+	}
+	return true;
+}
+
+void UdpSocket::Close()
+{
+	if (m_socket == s_invalid)
+		return;
+#ifdef _WIN32
+	closesocket(static_cast<SOCKET>(m_socket));
+#else
+	close(static_cast<SOCKET>(m_socket));
+#endif
+	m_socket = s_invalid;
+}
+
+uint16_t UdpSocket::GetLocalPort() const
+{
+	sockaddr_in addr{};
+	socklen_t len = sizeof(addr);
+	if (getsockname(static_cast<SOCKET>(m_socket), reinterpret_cast<sockaddr*>(&addr), &len) != 0)
+		return 0;
+	return ntohs(addr.sin_port);
+}
+
+bool UdpSocket::SendTo(const NetAddress& to, const void* data, size_t size)
+{
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(to.ip);
+	addr.sin_port = htons(to.port);
+	auto sent = sendto(static_cast<SOCKET>(m_socket), static_cast<const char*>(data), static_cast<int>(size), 0,
+		reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+	return sent == static_cast<decltype(sent)>(size);
+}
+
+int32_t UdpSocket::RecvFrom(NetAddress& from, void* data, size_t capacity)
+{
+	sockaddr_in addr{};
+	socklen_t len = sizeof(addr);
+	auto got = recvfrom(static_cast<SOCKET>(m_socket), static_cast<char*>(data), static_cast<int>(capacity), 0,
+		reinterpret_cast<sockaddr*>(&addr), &len);
+	if (got < 0)
+		return -1;
+	from.ip = ntohl(addr.sin_addr.s_addr);
+	from.port = ntohs(addr.sin_port);
+	return static_cast<int32_t>(got);
+}
+
+bool UdpSocket::Resolve(const std::string& host, uint16_t port, NetAddress& out)
+{
+#ifdef _WIN32
+	if (!InitSockets())
+		return false;
+#endif
+	addrinfo hints{};
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	addrinfo* res = nullptr;
+	if (getaddrinfo(host.c_str(), nullptr, &hints, &res) != 0 || !res) {
+		GAME_ERROR(std::format("Could not resolve {}", host));
+		return false;
+	}
+	out.ip = ntohl(reinterpret_cast<const sockaddr_in*>(res->ai_addr)->sin_addr.s_addr);
+	out.port = port;
+	freeaddrinfo(res);
+	return true;
+}
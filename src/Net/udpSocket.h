@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/** IPv4 address and port in host byte order */
+struct NetAddress
+{
+	uint32_t ip = 0;
+	uint16_t port = 0;
+
+	bool operator==(const NetAddress& other) const = default;
+	std::string ToString() const;
+};
+
+/** Non-blocking IPv4 UDP socket */
+class UdpSocket
+{
+public:
+	UdpSocket();
+	~UdpSocket();
+
+	UdpSocket(const UdpSocket& other) = delete;
+	UdpSocket& operator=(const UdpSocket& other) = delete;
+
+	/** Binds to the port on all interfaces, port 0 picks a free one */
+	bool Open(uint16_t port);
+	void Close();
+	inline bool IsOpen() const { return m_socket != s_invalid; }
+	/** The native SOCKET or file descriptor, for waiting on it with a Poller */
+	inline uintptr_t GetHandle() const { return m_socket; }
+	uint16_t GetLocalPort() const;
+
+	bool SendTo(const NetAddress& to, const void* data, size_t size);
+	/** Returns the size of the received datagram, or -1 if nothing is waiting */
+	int32_t RecvFrom(NetAddress& from, void* data, size_t capacity);
+
+	static bool Resolve(const std::string& host, uint16_t port, NetAddress& out);
+
+private:
+	// SOCKET on Windows, file descriptor elsewhere
+	uintptr_t m_socket;
+
+	static constexpr uintptr_t s_invalid = ~static_cast<uintptr_t>(0);
+};
@@ -0,0 +1,302 @@
+#include "debugOverlay.h"
+#include "renderer.h"
+#include "../Utils/frameStats.h"
+#include "../Utils/memoryUsage.h"
+#include "../gameState.h"
+
+#include <glad/glad.h>
+
+#define NK_INCLUDE_FIXED_TYPES
+#define NK_INCLUDE_DEFAULT_ALLOCATOR
+#define NK_INCLUDE_VERTEX_BUFFER_OUTPUT
+#define NK_INCLUDE_FONT_BAKING
+#define NK_INCLUDE_DEFAULT_FONT
+#define NK_IMPLEMENTATION
+#include <nuklear.h>
+
+// Upper bounds of one frame's geometry, the buffers are allocated once at these sizes
+static constexpr size_t s_maxVertexBytes = 512 * 1024;
+static constexpr size_t s_maxElementBytes = 128 * 1024;
+// Samples shown in the graphs
+static constexpr size_t s_graphSamples = 240;
+// Reading the resident size goes through the OS, no need to do it every frame
+static constexpr float s_memoryInterval = 0.5f;
+
+static const char* s_vertSrc = R"(#version 330 core
+layout(location = 0) in vec2 a_Pos;
+layout(location = 1) in vec2 a_UV;
+layout(location = 2) in vec4 a_Color;
+uniform mat4 u_Proj;
+out vec2 v_UV;
+out vec4 v_Color;
+void main()
+{
+	v_UV = a_UV;
+	v_Color = a_Color;
+	gl_Position = u_Proj * vec4(a_Pos, 0.0, 1.0);
+}
+)";
+
+static const char* s_fragSrc = R"(#version 330 core
+uniform sampler2D u_Font;
+in vec2 v_UV;
+in vec4 v_Color;
+out vec4 o_Color;
+void main()
+{
+	o_Color = v_Color * texture(u_Font, v_UV);
+}
+)";
+
+struct OverlayVertex
+{
+	float pos[2];
+	float uv[2];
+	nk_byte col[4];
+};
+
+struct DebugOverlay::Impl
+{
+	nk_context ctx;
+	nk_font_atlas atlas;
+	nk_draw_null_texture nullTex;
+	nk_buffer cmds;
+	RID program = 0, vb = 0, ib = 0, va = 0, fontTex = 0;
+	int32_t projLoc = -1;
+	std::vector<float> samples;
+	size_t rss = 0;
+	float lastRssTime = -1.0f;
+};
+
+static RID CompileStage(GLenum type, const char* src)
+{
+	RID id = glCreateShader(type);
+	glShaderSource(id, 1, &src, nullptr);
+	glCompileShader(id);
+
+	GLint ok = GL_FALSE;
+	glGetShaderiv(id, GL_COMPILE_STATUS, &ok);
+	if (!ok) {
+		char log[512];
+		glGetShaderInfoLog(id, sizeof(log), nullptr, log);
+		RENDERER_ERROR(std::format("Overlay shader failed to compile: {}", log));
+		glDeleteShader(id);
+		return 0;
+	}
+	return id;
+}
+
+DebugOverlay::DebugOverlay()
+	: m_impl(nullptr), m_drawCalls(0)
+{
+}
+
+DebugOverlay::~DebugOverlay()
+{
+	if (!m_impl)
+		return;
+	nk_buffer_free(&m_impl->cmds);
+	nk_font_atlas_clear(&m_impl->atlas);
+	nk_free(&m_impl->ctx);
+	glDeleteTextures(1, &m_impl->fontTex);
+	glDeleteBuffers(1, &m_impl->vb);
+	glDeleteBuffers(1, &m_impl->ib);
+	glDeleteVertexArrays(1, &m_impl->va);
+	glDeleteProgram(m_impl->program);
+}
+
+bool DebugOverlay::Init()
+{
+	auto impl = std::make_unique<Impl>();
+
+	RID vs = CompileStage(GL_VERTEX_SHADER, s_vertSrc);
+	RID fs = CompileStage(GL_FRAGMENT_SHADER, s_fragSrc);
+	if (vs == 0 || fs == 0) {
+		glDeleteShader(vs);
+		glDeleteShader(fs);
+		return false;
+	}
+	impl->program = glCreateProgram();
+	glAttachShader(impl->program, vs);
+	glAttachShader(impl->program, fs);
+	glLinkProgram(impl->program);
+	glDeleteShader(vs);
+	glDeleteShader(fs);
+	GLint linked = GL_FALSE;
+	glGetProgramiv(impl->program, GL_LINK_STATUS, &linked);
+	if (!linked) {
+		RENDERER_ERROR("Overlay shader failed to link");
+		glDeleteProgram(impl->program);
+		return false;
+	}
+	impl->projLoc = glGetUniformLocation(impl->program, "u_Proj");
+	glProgramUniform1i(impl->program, glGetUniformLocation(impl->program, "u_Font"), 0);
+
+	// One vertex and index buffer for the whole overlay, refilled every frame
+	glCreateVertexArrays(1, &impl->va);
+	glCreateBuffers(1, &impl->vb);
+	glCreateBuffers(1, &impl->ib);
+	glNamedBufferData(impl->vb, s_maxVertexBytes, nullptr, GL_STREAM_DRAW);
+	glNamedBufferData(impl->ib, s_maxElementBytes, nullptr, GL_STREAM_DRAW);
+	glVertexArrayVertexBuffer(impl->va, 0, impl->vb, 0, sizeof(OverlayVertex));
+	glVertexArrayElementBuffer(impl->va, impl->ib);
+	glEnableVertexArrayAttrib(impl->va, 0);
+	glEnableVertexArrayAttrib(impl->va, 1);
+	glEnableVertexArrayAttrib(impl->va, 2);
+	glVertexArrayAttribFormat(impl->va, 0, 2, GL_FLOAT, GL_FALSE, offsetof(OverlayVertex, pos));
+	glVertexArrayAttribFormat(impl->va, 1, 2, GL_FLOAT, GL_FALSE, offsetof(OverlayVertex, uv));
+	glVertexArrayAttribFormat(impl->va, 2, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(OverlayVertex, col));
+	glVertexArrayAttribBinding(impl->va, 0, 0);
+	glVertexArrayAttribBinding(impl->va, 1, 0);
+	glVertexArrayAttribBinding(impl->va, 2, 0);
+
+	// Default font baked into a texture, it also holds the white pixel used for untextured shapes
+	nk_font_atlas_init_default(&impl->atlas);
+	nk_font_atlas_begin(&impl->atlas);
+	nk_font* font = nk_font_atlas_add_default(&impl->atlas, 13.0f, nullptr);
+	int texW = 0, texH = 0;
+	const void* pixels = nk_font_atlas_bake(&impl->atlas, &texW, &texH, NK_FONT_ATLAS_RGBA32);
+	glCreateTextures(GL_TEXTURE_2D, 1, &impl->fontTex);
+	glTextureStorage2D(impl->fontTex, 1, GL_RGBA8, texW, texH);
+	glTextureSubImage2D(impl->fontTex, 0, 0, 0, texW, texH, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glTextureParameteri(impl->fontTex, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(impl->fontTex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	nk_font_atlas_end(&impl->atlas, nk_handle_id(static_cast<int>(impl->fontTex)), &impl->nullTex);
+
+	nk_init_default(&impl->ctx, &font->handle);
+	nk_buffer_init_default(&impl->cmds);
+	impl->samples.reserve(s_graphSamples);
+
+	m_impl = std::move(impl);
+	return true;
+}
+
+void DebugOverlay::Draw(const Renderer& rend, const FrameStats& stats, const GameSnapshot& snap)
+{
+	if (!m_impl)
+		return;
+	auto [w, h] = rend.GetWindowSize();
+	this->Build(rend, stats, snap);
+	this->Render(w, h);
+}
+
+void DebugOverlay::Build(const Renderer& rend, const FrameStats& stats, const GameSnapshot& snap)
+{
+	nk_context* ctx = &m_impl->ctx;
+	const nk_flags flags = NK_WINDOW_BORDER | NK_WINDOW_TITLE | NK_WINDOW_NOT_INTERACTIVE | NK_WINDOW_NO_SCROLLBAR;
+
+	if (nk_begin(ctx, "Debug", nk_rect(10, 10, 320, 440), flags)) {
+		// Frame time graphs, scaled to at least 30 FPS so that the usual range doesn't jump around
+		const StatChannel graphs[] = { Stat_Frame, Stat_Render, Stat_Sim };
+		for (StatChannel ch : graphs) {
+			const StatSummary s = stats.GetSummary(ch);
+			stats.GetRecent(ch, s_graphSamples, m_impl->samples);
+			float maxMs = 1000.f / 30.f;
+			for (float& v : m_impl->samples) {
+				v *= 1e3f;
+				maxMs = std::max(maxMs, v);
+			}
+
+			nk_layout_row_dynamic(ctx, 16, 1);
+			nk_label(ctx, std::format("{} p50 {:.2f}ms p99 {:.2f}ms max {:.2f}ms", FrameStats::GetName(ch), s.p50 * 1e3f, s.p99 * 1e3f, s.max * 1e3f).c_str(), NK_TEXT_LEFT);
+			nk_layout_row_dynamic(ctx, 50, 1);
+			if (nk_chart_begin(ctx, NK_CHART_LINES, static_cast<int>(m_impl->samples.size()), 0.0f, maxMs)) {
+				for (float v : m_impl->samples)
+					nk_chart_push(ctx, v);
+				nk_chart_end(ctx);
+			}
+		}
+
+		nk_layout_row_dynamic(ctx, 16, 1);
+		for (int p = 0; p < GpuPass_COUNT; p++)
+			nk_label(ctx, std::format("GPU {} {:.3f}ms", GpuTimers::GetName(static_cast<GpuPass>(p)), rend.GetGpuPassMs(static_cast<GpuPass>(p))).c_str(), NK_TEXT_LEFT);
+
+		const RenderCounters& counters = rend.GetCounters();
+		nk_label(ctx, std::format("Draw calls {}, state changes {}", counters.drawCalls, counters.stateChanges).c_str(), NK_TEXT_LEFT);
+		nk_label(ctx, std::format("Dots {}, wells {}, tick {}", snap.dots.size(), snap.wells.size(), snap.tick).c_str(), NK_TEXT_LEFT);
+
+		const float now = rend.GetElapsedSecs();
+		if (now - m_impl->lastRssTime > s_memoryInterval) {
+			m_impl->rss = GetResidentMemory();
+			m_impl->lastRssTime = now;
+		}
+		nk_label(ctx, std::format("Resident memory {:.1f} MiB", m_impl->rss / (1024.0 * 1024.0)).c_str(), NK_TEXT_LEFT);
+
+		// What showing all this costs
+		const StatSummary own = stats.GetSummary(Stat_Overlay);
+		nk_label(ctx, std::format("Overlay CPU p50 {:.3f}ms, GPU {:.3f}ms", own.p50 * 1e3f, rend.GetGpuPassMs(Pass_Overlay)).c_str(), NK_TEXT_LEFT);
+		nk_label(ctx, std::format("Overlay draw calls {}", m_drawCalls).c_str(), NK_TEXT_LEFT);
+	}
+	nk_end(ctx);
+}
+
+void DebugOverlay::Render(int w, int h)
+{
+	Impl& im = *m_impl;
+
+	static const nk_draw_vertex_layout_element layout[] = {
+		{ NK_VERTEX_POSITION, NK_FORMAT_FLOAT, NK_OFFSETOF(OverlayVertex, pos) },
+		{ NK_VERTEX_TEXCOORD, NK_FORMAT_FLOAT, NK_OFFSETOF(OverlayVertex, uv) },
+		{ NK_VERTEX_COLOR, NK_FORMAT_R8G8B8A8, NK_OFFSETOF(OverlayVertex, col) },
+		{ NK_VERTEX_LAYOUT_END }
+	};
+	nk_convert_config config{};
+	config.vertex_layout = layout;
+	config.vertex_size = sizeof(OverlayVertex);
+	config.vertex_alignment = NK_ALIGNOF(OverlayVertex);
+	config.null = im.nullTex;
+	config.circle_segment_count = 22;
+	config.curve_segment_count = 22;
+	config.arc_segment_count = 22;
+	config.global_alpha = 1.0f;
+	config.shape_AA = NK_ANTI_ALIASING_ON;
+	config.line_AA = NK_ANTI_ALIASING_ON;
+
+	// Nuklear writes the geometry straight into the mapped buffers, the old contents are orphaned
+	void* vertices = glMapNamedBufferRange(im.vb, 0, s_maxVertexBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	void* elements = glMapNamedBufferRange(im.ib, 0, s_maxElementBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	nk_buffer vbuf, ebuf;
+	nk_buffer_init_fixed(&vbuf, vertices, s_maxVertexBytes);
+	nk_buffer_init_fixed(&ebuf, elements, s_maxElementBytes);
+	const nk_flags result = nk_convert(&im.ctx, &im.cmds, &vbuf, &ebuf, &config);
+	glUnmapNamedBuffer(im.vb);
+	glUnmapNamedBuffer(im.ib);
+	if (result != NK_CONVERT_SUCCESS) {
+		RENDERER_WARN("Debug overlay didn't fit in its buffers");
+		nk_clear(&im.ctx);
+		nk_buffer_clear(&im.cmds);
+		return;
+	}
+
+	const float proj[16] = {
+		2.0f / w, 0.0f, 0.0f, 0.0f,
+		0.0f, -2.0f / h, 0.0f, 0.0f,
+		0.0f, 0.0f, -1.0f, 0.0f,
+		-1.0f, 1.0f, 0.0f, 1.0f
+	};
+	glUseProgram(im.program);
+	glUniformMatrix4fv(im.projLoc, 1, GL_FALSE, proj);
+	glBindVertexArray(im.va);
+	glBindTextureUnit(0, im.fontTex);
+	glEnable(GL_SCISSOR_TEST);
+
+	// One draw per clip rectangle, Nuklear merges everything else
+	uint32_t drawCalls = 0;
+	const nk_draw_index* offset = nullptr;
+	const nk_draw_command* cmd;
+	nk_draw_foreach(cmd, &im.ctx, &im.cmds) {
+		if (!cmd->elem_count)
+			continue;
+		glScissor(static_cast<GLint>(cmd->clip_rect.x), static_cast<GLint>(h - (cmd->clip_rect.y + cmd->clip_rect.h)),
+			static_cast<GLint>(std::max(cmd->clip_rect.w, 0.0f)), static_cast<GLint>(std::max(cmd->clip_rect.h, 0.0f)));
+		glDrawElements(GL_TRIANGLES, cmd->elem_count, GL_UNSIGNED_SHORT, offset);
+		offset += cmd->elem_count;
+		drawCalls++;
+	}
+	m_drawCalls = drawCalls;
+
+	glDisable(GL_SCISSOR_TEST);
+	glBindTextureUnit(0, 0);
+	nk_clear(&im.ctx);
+	nk_buffer_clear(&im.cmds);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+class Renderer;
+class FrameStats;
+struct GameSnapshot;
+
+/**
+ * Debug overlay with frame time graphs, GPU pass times, draw counts, entity counts and memory usage.
+ * Built with Nuklear and drawn through its own GL core profile backend in one batched pass after the scene.
+ * Display only, it never takes input from the game.
+ */
+class DebugOverlay
+{
+public:
+	DebugOverlay();
+	~DebugOverlay();
+
+	/** Needs the renderer's context to be current, as do Draw and the destructor */
+	bool Init();
+	void Draw(const Renderer& rend, const FrameStats& stats, const GameSnapshot& snap);
+
+	inline bool IsInitSuccess() const { return m_impl != nullptr; }
+	/** Draw calls of the overlay's own previous frame */
+	inline uint32_t GetDrawCalls() const { return m_drawCalls; }
+
+private:
+	struct Impl;	// Keeps Nuklear out of the header
+	std::unique_ptr<Impl> m_impl;
+	uint32_t m_drawCalls;
+private:
+	void Build(const Renderer& rend, const FrameStats& stats, const GameSnapshot& snap);
+	void Render(int w, int h);
+};
@@ -0,0 +1,74 @@
+#include "gpuTimer.h"
+
+#include <glad/glad.h>
+
+GpuTimers::GpuTimers()
+	: m_queries(), m_issued(), m_frame(0), m_ms(), m_active(false)
+{
+}
+
+void GpuTimers::Init()
+{
+	glGenQueries(s_frames * GpuPass_COUNT, &m_queries[0][0]);
+}
+
+void GpuTimers::Release()
+{
+	glDeleteQueries(s_frames * GpuPass_COUNT, &m_queries[0][0]);
+}
+
+const char* GpuTimers::GetName(GpuPass pass)
+{
+	switch (pass) {
+	case Pass_Background:
+		return "background";
+	case Pass_Entities:
+		return "entities";
+	case Pass_Particles:
+		return "particles";
+	case Pass_Overlay:
+		return "overlay";
+	default:
+		return "unknown";
+	}
+}
+
+void GpuTimers::Begin(GpuPass pass)
+{
+	// Only one time elapsed query can run at a time
+	if (m_active)
+		this->End();
+	const uint32_t slot = m_frame % s_frames;
+	glBeginQuery(GL_TIME_ELAPSED, m_queries[slot][pass]);
+	m_issued[slot][pass] = true;
+	m_active = true;
+}
+
+void GpuTimers::End()
+{
+	if (!m_active)
+		return;
+	glEndQuery(GL_TIME_ELAPSED);
+	m_active = false;
+}
+
+void GpuTimers::EndFrame()
+{
+	this->End();
+	m_frame++;
+
+	// The oldest set, about to be reused
+	const uint32_t slot = m_frame % s_frames;
+	for (int p = 0; p < GpuPass_COUNT; p++) {
+		if (!m_issued[slot][p])
+			continue;
+		GLint available = 0;
+		glGetQueryObjectiv(m_queries[slot][p], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			continue;
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(m_queries[slot][p], GL_QUERY_RESULT, &ns);
+		m_ms[p] = static_cast<float>(ns) * 1e-6f;
+		m_issued[slot][p] = false;
+	}
+}
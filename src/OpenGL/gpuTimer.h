@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+typedef uint32_t RID;
+
+enum GpuPass
+{
+	Pass_Background = 0,
+	Pass_Entities,
+	Pass_Particles,
+	Pass_Overlay,
+	GpuPass_COUNT
+};
+
+/**
+ * GPU time of each render pass with timer queries. Results are read a few frames late from a ring of queries,
+ * so asking for them never waits on the GPU.
+ */
+class GpuTimers
+{
+public:
+	GpuTimers();
+	~GpuTimers() = default;
+
+	void Init();
+	void Release();
+	void Begin(GpuPass pass);
+	void End();
+	/** Picks up the results that are ready and moves on to the next set of queries */
+	void EndFrame();
+
+	inline float GetMs(GpuPass pass) const { return m_ms[pass]; }
+	static const char* GetName(GpuPass pass);
+
+private:
+	static constexpr uint32_t s_frames = 4;
+
+	RID m_queries[s_frames][GpuPass_COUNT];
+	bool m_issued[s_frames][GpuPass_COUNT];
+	uint32_t m_frame;
+	float m_ms[GpuPass_COUNT];
+	bool m_active;
+};
@@ -0,0 +1,37 @@
+#include "input.h"
+
+InputState::InputState()
+	: m_held(), m_pressed(), m_released(), m_buttons(), m_mouse({ 0.0f, 0.0f }), m_lastEventTime(0.0)
+{
+}
+
+void InputState::BeginTick()
+{
+	m_pressed.reset();
+	m_released.reset();
+}
+
+void InputState::Apply(const InputEvent& ev)
+{
+	m_lastEventTime = ev.time;
+	m_mouse = Vec2({ ev.x, ev.y });
+
+	switch (ev.type) {
+	case Ev_Key:
+		if (!InRange(ev.code))
+			break;
+		// Repeats of a held key aren't new presses
+		if (ev.down && !m_held[ev.code])
+			m_pressed[ev.code] = true;
+		else if (!ev.down && m_held[ev.code])
+			m_released[ev.code] = true;
+		m_held[ev.code] = ev.down;
+		break;
+	case Ev_MouseButton:
+		if (ev.code >= 0 && ev.code < s_buttonCount)
+			m_buttons[ev.code] = ev.down;
+		break;
+	case Ev_MouseMove:
+		break;
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "../Utils/matrix.h"
+#include "keys.h"
+
+#include <bitset>
+
+enum InputEventType : uint8_t
+{
+	Ev_Key,
+	Ev_MouseButton,
+	Ev_MouseMove
+};
+
+/** One key, button or cursor change as reported by the window callbacks */
+struct InputEvent
+{
+	double time;		// Seconds since the renderer started
+	float x, y;			// Cursor position, y up
+	int32_t code;		// Key or mouse button
+	InputEventType type;
+	bool down;
+};
+
+/**
+ * Held keys and the presses and releases since the last tick, built from the event stream.
+ * A key that went down and up within one tick is still seen as pressed in that tick.
+ */
+class InputState
+{
+public:
+	InputState();
+
+	/** Forgets the presses and releases of the previous tick */
+	void BeginTick();
+	void Apply(const InputEvent& ev);
+
+	inline bool IsHeld(Key key) const { return InRange(key) && m_held[key]; }
+	inline bool WasPressed(Key key) const { return InRange(key) && m_pressed[key]; }
+	inline bool WasReleased(Key key) const { return InRange(key) && m_released[key]; }
+	/** Held now or pressed at any point during the tick */
+	inline bool IsDown(Key key) const { return IsHeld(key) || WasPressed(key); }
+	inline bool IsMouseDown(int32_t button) const { return button >= 0 && button < s_buttonCount && m_buttons[button]; }
+	inline const Vec2& GetMousePos() const { return m_mouse; }
+
+	/** Time of the newest event applied, for measuring input latency */
+	inline double GetLastEventTime() const { return m_lastEventTime; }
+
+private:
+	static constexpr size_t s_keyCount = KEY_MENU + 1;
+	static constexpr int32_t s_buttonCount = 8;
+
+	std::bitset<s_keyCount> m_held, m_pressed, m_released;
+	std::bitset<s_buttonCount> m_buttons;
+	Vec2 m_mouse;
+	double m_lastEventTime;
+private:
+	static inline bool InRange(int32_t key) { return key >= 0 && key < static_cast<int32_t>(s_keyCount); }
+};
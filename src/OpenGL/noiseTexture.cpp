@@ -0,0 +1,119 @@
+#include "noiseTexture.h"
+#include "../Utils/logger.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+
+// hash12 of noise.glsl
+static float Hash12(uint32_t x, uint32_t y)
+{
+	const uint32_t seed = (x * 6967u) ^ (y * 7919u);
+	const uint32_t state = seed * 747796405u + 2891336453u;
+	const uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return static_cast<float>((word >> 22u) ^ word) * (1.0f / 4294967295.0f);
+}
+
+NoiseTexture::NoiseTexture()
+	: m_thread(),
+	m_done(false),
+	m_texels(),
+	m_texture(0),
+	m_generateMs(0.f)
+{
+}
+
+NoiseTexture::~NoiseTexture()
+{
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+void NoiseTexture::Start()
+{
+	if (this->IsStarted())
+		return;
+	m_done = false;
+	m_thread = std::thread([this]() {
+		const auto start = std::chrono::steady_clock::now();
+		Generate(m_texels, s_size, s_period);
+		m_generateMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		m_done.store(true, std::memory_order_release);
+	});
+}
+
+bool NoiseTexture::Poll(bool wait)
+{
+	if (m_texture != 0)
+		return true;
+	if (!m_thread.joinable() || (!wait && !m_done.load(std::memory_order_acquire)))
+		return false;
+	m_thread.join();
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &m_texture);
+	glTextureStorage2D(m_texture, 1, GL_R8, s_size, s_size);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTextureSubImage2D(m_texture, 0, 0, 0, s_size, s_size, GL_RED, GL_UNSIGNED_BYTE, m_texels.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	// Only ever magnified, a texel covers several pixels
+	glTextureParameteri(m_texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(m_texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(m_texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(m_texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	m_texels = std::vector<uint8_t>();
+	RENDERER_INFO(std::format("Noise texture generated in {:.1f}ms", m_generateMs));
+	return true;
+}
+
+void NoiseTexture::Release()
+{
+	if (m_thread.joinable())
+		m_thread.join();
+	glDeleteTextures(1, &m_texture);
+	m_texture = 0;
+}
+
+void NoiseTexture::Generate(std::vector<uint8_t>& out, uint32_t size, uint32_t period)
+{
+	// Gradients of one tile, the lattice wraps around at period
+	std::vector<float> gradX(period * period), gradY(period * period);
+	for (uint32_t j = 0; j < period; j++) {
+		for (uint32_t i = 0; i < period; i++) {
+			const float angle = Hash12(std::bit_cast<uint32_t>(static_cast<float>(i)), std::bit_cast<uint32_t>(static_cast<float>(j))) * 6.28318530718f;
+			gradX[j * period + i] = std::cos(angle);
+			gradY[j * period + i] = std::sin(angle);
+		}
+	}
+	auto corner = [&](uint32_t i, uint32_t j, float fx, float fy) {
+		const uint32_t g = (j % period) * period + (i % period);
+		return gradX[g] * fx + gradY[g] * fy;
+	};
+
+	out.resize(static_cast<size_t>(size) * size);
+	const float cellsPerTexel = static_cast<float>(period) / static_cast<float>(size);
+	for (uint32_t y = 0; y < size; y++) {
+		// Texel centers, where a linear filter returns the texel itself
+		const float cy = (static_cast<float>(y) + 0.5f) * cellsPerTexel;
+		const uint32_t iy = static_cast<uint32_t>(cy);
+		const float fy = cy - static_cast<float>(iy);
+		const float wy = fy * fy * (3.f - 2.f * fy);
+		for (uint32_t x = 0; x < size; x++) {
+			const float cx = (static_cast<float>(x) + 0.5f) * cellsPerTexel;
+			const uint32_t ix = static_cast<uint32_t>(cx);
+			const float fx = cx - static_cast<float>(ix);
+			const float wx = fx * fx * (3.f - 2.f * fx);
+
+			const float n0 = corner(ix, iy, fx, fy);
+			const float n1 = corner(ix + 1, iy, fx - 1.f, fy);
+			const float n2 = corner(ix, iy + 1, fx, fy - 1.f);
+			const float n3 = corner(ix + 1, iy + 1, fx - 1.f, fy - 1.f);
+			const float bottom = n0 + (n1 - n0) * wx;
+			const float top = n2 + (n3 - n2) * wx;
+			const float v = (bottom + (top - bottom) * wy + 1.f) * 0.5f;
+			out[static_cast<size_t>(y) * size + x] = static_cast<uint8_t>(std::clamp(v, 0.f, 1.f) * 255.f + 0.5f);
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+typedef uint32_t RID;
+
+/**
+ * Tileable gradient noise in a single channel texture, for the background's texture quality level.
+ * The noise is the same as perlin() in noise.glsl with the lattice wrapped every s_period cells, so over one tile both
+ * paths show the same field. It's generated on its own thread and uploaded by the first Poll after it's done.
+ */
+class NoiseTexture
+{
+public:
+	NoiseTexture();
+	~NoiseTexture();
+
+	NoiseTexture(const NoiseTexture& other) = delete;
+	NoiseTexture& operator=(const NoiseTexture& other) = delete;
+
+	/** Starts generating, later calls do nothing */
+	void Start();
+	/** Uploads the texture once it's generated, with wait it blocks until then. True when the texture is ready */
+	bool Poll(bool wait);
+	void Release();
+
+	inline bool IsStarted() const { return m_thread.joinable() || m_texture != 0; }
+	inline bool IsReady() const { return m_texture != 0; }
+	inline RID GetTexture() const { return m_texture; }
+
+	/** size * size texels of noise values in [0, 255], repeating every period lattice cells in both directions */
+	static void Generate(std::vector<uint8_t>& out, uint32_t size, uint32_t period);
+
+	static constexpr uint32_t s_size = 512;
+	static constexpr uint32_t s_period = 16;	// Lattice cells across the texture, 32 texels each
+
+private:
+	std::thread m_thread;
+	std::atomic<bool> m_done;
+	std::vector<uint8_t> m_texels;	// Written by the thread until m_done
+	RID m_texture;
+	float m_generateMs;
+};
@@ -0,0 +1,217 @@
+#include "particles.h"
+#include "../Utils/logger.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// Layout of Particle in particles.glsl
+struct GpuParticle
+{
+	float pos[2], vel[2];
+	float age, life, size;
+	uint32_t color;
+};
+
+static_assert(sizeof(GpuParticle) == 32, "Has to match the std430 layout of Particle");
+
+// packUnorm4x8, red in the lowest byte
+static uint32_t PackColor(const Vec4& c)
+{
+	uint32_t packed = 0;
+	for (size_t i = 0; i < 4; i++)
+		packed |= static_cast<uint32_t>(std::clamp(c[i], 0.f, 1.f) * 255.f + 0.5f) << (8 * i);
+	return packed;
+}
+
+ParticleSystem::ParticleSystem()
+	: m_particles{ 0, 0 },
+	m_counters(0), m_args(0), m_emitters(0),
+	m_va(0),
+	m_capacity(0),
+	m_src(0),
+	m_pending(),
+	m_pendingParticles(0),
+	m_attractors(),
+	m_seed(0)
+{
+}
+
+bool ParticleSystem::Init(uint32_t capacity)
+{
+	this->Release();
+	GLint maxBlockSize = 0, maxGroups = 0;
+	glGetIntegerv(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &maxBlockSize);
+	glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &maxGroups);
+	const uint64_t limit = std::min<uint64_t>(static_cast<uint64_t>(maxBlockSize) / sizeof(GpuParticle), static_cast<uint64_t>(maxGroups) * s_groupSize);
+	if (capacity > limit) {
+		RENDERER_WARN(std::format("{} particles don't fit in a shader storage block, capped to {}", capacity, limit));
+		capacity = static_cast<uint32_t>(limit);
+	}
+	if (capacity == 0)
+		return false;
+	m_capacity = capacity;
+	m_src = 0;
+
+	glCreateBuffers(2, m_particles);
+	for (RID buffer : m_particles)
+		glNamedBufferStorage(buffer, static_cast<GLsizeiptr>(capacity) * sizeof(GpuParticle), nullptr, 0);
+	const uint32_t counts[2] = { 0, 0 };
+	glCreateBuffers(1, &m_counters);
+	glNamedBufferStorage(m_counters, sizeof(counts), counts, 0);
+	// Nothing to simulate or draw until the first Update
+	const uint32_t args[8] = { 0, 1, 1, 0, 0, 1, 0, 0 };
+	glCreateBuffers(1, &m_args);
+	glNamedBufferStorage(m_args, sizeof(args), args, 0);
+	glCreateBuffers(1, &m_emitters);
+	glNamedBufferStorage(m_emitters, s_maxEmitters * sizeof(GpuEmitter), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	// Particles are the vertices, the buffer is attached when drawing
+	glCreateVertexArrays(1, &m_va);
+	glEnableVertexArrayAttrib(m_va, 0);
+	glEnableVertexArrayAttrib(m_va, 1);
+	glEnableVertexArrayAttrib(m_va, 2);
+	glVertexArrayAttribFormat(m_va, 0, 2, GL_FLOAT, GL_FALSE, offsetof(GpuParticle, pos));
+	glVertexArrayAttribFormat(m_va, 1, 3, GL_FLOAT, GL_FALSE, offsetof(GpuParticle, age));
+	glVertexArrayAttribFormat(m_va, 2, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(GpuParticle, color));
+	glVertexArrayAttribBinding(m_va, 0, 0);
+	glVertexArrayAttribBinding(m_va, 1, 0);
+	glVertexArrayAttribBinding(m_va, 2, 0);
+
+	RENDERER_INFO(std::format("Room for {} particles, {:.1f}MB", capacity, 2.0 * capacity * sizeof(GpuParticle) / (1024.0 * 1024.0)));
+	return true;
+}
+
+void ParticleSystem::Release()
+{
+	glDeleteBuffers(2, m_particles);
+	glDeleteBuffers(1, &m_counters);
+	glDeleteBuffers(1, &m_args);
+	glDeleteBuffers(1, &m_emitters);
+	glDeleteVertexArrays(1, &m_va);
+	m_particles[0] = m_particles[1] = 0;
+	m_counters = m_args = m_emitters = 0;
+	m_va = 0;
+	m_capacity = 0;
+	m_pending.clear();
+	m_pendingParticles = 0;
+	m_attractors.clear();
+}
+
+void ParticleSystem::Emit(const ParticleEmitter& e)
+{
+	if (!this->IsInit() || e.count == 0 || m_pending.size() >= s_maxEmitters)
+		return;
+	// More than the capacity would only be dropped by the shader
+	const uint32_t count = std::min(e.count, m_capacity - std::min(m_pendingParticles, m_capacity));
+	if (count == 0)
+		return;
+	GpuEmitter& g = m_pending.emplace_back();
+	g.pos[0] = e.pos[0]; g.pos[1] = e.pos[1];
+	g.from[0] = e.from[0]; g.from[1] = e.from[1];
+	g.vel[0] = e.vel[0]; g.vel[1] = e.vel[1];
+	g.dir[0] = e.dir[0]; g.dir[1] = e.dir[1];
+	g.speed = e.speed;
+	g.spread = e.spread;
+	g.radius = e.radius;
+	g.life = e.life;
+	g.size = e.size;
+	g.color = PackColor(e.color);
+	g.kind = e.kind;
+	g.first = m_pendingParticles;
+	g.count = count;
+	// Golden ratio steps, so consecutive emitters don't get related random streams
+	g.seed = (m_seed++) * 0x9e3779b9u;
+	m_pendingParticles += count;
+}
+
+void ParticleSystem::AddAttractor(Vec2 pos, float strength, float killRad)
+{
+	if (m_attractors.size() / 4 >= s_maxAttractors)
+		return;
+	m_attractors.insert(m_attractors.end(), { pos[0], pos[1], strength, killRad });
+}
+
+void ParticleSystem::Update(ShaderStorage& shaders, float dt)
+{
+	if (!this->IsInit() || !shaders.IsReady(Sh_ParticleSimulate) || !shaders.IsReady(Sh_ParticleEmit) || !shaders.IsReady(Sh_ParticleFinish)) {
+		m_pending.clear();
+		m_pendingParticles = 0;
+		m_attractors.clear();
+		return;
+	}
+	const uint32_t dst = 1 - m_src;
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_particles[m_src]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_particles[dst]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_counters);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_args);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_emitters);
+
+	// Sized by the previous frame's particleFinish
+	Shader& simulate = shaders.GetShader(Sh_ParticleSimulate);
+	simulate.Bind();
+	simulate.SetUniform1ui("u_Src", m_src);
+	simulate.SetUniform1f("u_Dt", dt);
+	simulate.SetUniform1f("u_Drag", s_drag);
+	simulate.SetUniform1i("u_AttractorCount", static_cast<int32_t>(m_attractors.size() / 4));
+	if (!m_attractors.empty())
+		simulate.SetUniform4fv("u_Attractors", static_cast<uint32_t>(m_attractors.size() / 4), m_attractors.data());
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, m_args);
+	glDispatchComputeIndirect(0);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	if (!m_pending.empty()) {
+		glNamedBufferSubData(m_emitters, 0, m_pending.size() * sizeof(GpuEmitter), m_pending.data());
+		Shader& emit = shaders.GetShader(Sh_ParticleEmit);
+		emit.Bind();
+		emit.SetUniform1ui("u_Src", m_src);
+		emit.SetUniform1ui("u_Capacity", m_capacity);
+		emit.SetUniform1ui("u_EmitterCount", static_cast<uint32_t>(m_pending.size()));
+		emit.SetUniform1ui("u_Total", m_pendingParticles);
+		glDispatchCompute((m_pendingParticles + s_groupSize - 1) / s_groupSize, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	Shader& finish = shaders.GetShader(Sh_ParticleFinish);
+	finish.Bind();
+	finish.SetUniform1ui("u_Src", m_src);
+	finish.SetUniform1ui("u_Capacity", m_capacity);
+	glDispatchCompute(1, 1, 1);
+	// The arguments are read by the next dispatch and the draw, the particles as vertex attributes
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+	m_src = dst;
+	m_pending.clear();
+	m_pendingParticles = 0;
+	m_attractors.clear();
+}
+
+void ParticleSystem::Draw(ShaderStorage& shaders, int w, int h)
+{
+	if (!this->IsInit() || !shaders.IsReady(Sh_Particle))
+		return;
+	Shader& shader = shaders.GetShader(Sh_Particle);
+	shader.Bind();
+	shader.SetUniform2f("u_WindDim", static_cast<float>(w), static_cast<float>(h));
+	glVertexArrayVertexBuffer(m_va, 0, m_particles[m_src], 0, sizeof(GpuParticle));
+	glBindVertexArray(m_va);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_args);
+
+	glEnable(GL_PROGRAM_POINT_SIZE);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+	glDrawArraysIndirect(GL_POINTS, reinterpret_cast<const void*>(4 * sizeof(uint32_t)));
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_PROGRAM_POINT_SIZE);
+}
+
+uint32_t ParticleSystem::ReadCount() const
+{
+	if (!this->IsInit())
+		return 0;
+	uint32_t count = 0;
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glGetNamedBufferSubData(m_counters, m_src * sizeof(uint32_t), sizeof(count), &count);
+	return count;
+}
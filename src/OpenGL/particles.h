@@ -0,0 +1,94 @@
+#pragma once
+
+#include "../Utils/matrix.h"
+#include "shader.h"
+
+#include <cstdint>
+#include <vector>
+
+typedef uint32_t RID;
+
+/** How an emitter places its particles, as the EMIT_ defines of particleEmit.comp */
+enum ParticleEmitterKind : uint32_t
+{
+	Emit_Trail = 0,	// Along the segment from..pos, drifting off in random directions at up to speed
+	Emit_Burst,		// From a circle of radius around pos, within spread radians of dir
+	Emit_Ring,		// On a circle of radius around pos, moving along it at speed
+	ParticleEmitterKind_COUNT
+};
+
+/** Particles spawned during one Update. Positions are in pixels and velocities in pixels per second */
+struct ParticleEmitter
+{
+	ParticleEmitterKind kind = Emit_Burst;
+	uint32_t count = 0;
+	Vec2 pos = Vec2({ 0.f, 0.f });
+	Vec2 from = Vec2({ 0.f, 0.f });	// Start of a trail
+	Vec2 vel = Vec2({ 0.f, 0.f });		// Added to every particle
+	Vec2 dir = Vec2({ 1.f, 0.f });
+	float speed = 0.f;
+	float spread = 6.28318530718f;
+	float radius = 0.f;
+	float life = 1.f;		// Seconds, each particle lives between 0.75 and 1.25 times this
+	float size = 2.f;		// Half size of the sprite in pixels, shrinks to half over the life
+	Vec4 color = Vec4({ 1.f, 1.f, 1.f, 1.f });	// Fades out over the life
+};
+
+/**
+ * Particles that live on the GPU. Compute shaders move them, append the survivors and the new ones to the other of two
+ * buffers with atomic counters, and write the arguments of the next dispatch and of the draw themselves, so the CPU never
+ * reads the particle count back. Emitters and attractors only cost a small upload per frame, whatever the particle count.
+ * Needs GL 4.3, without the particle shaders Update and Draw do nothing.
+ */
+class ParticleSystem
+{
+public:
+	ParticleSystem();
+	~ParticleSystem() = default;
+
+	ParticleSystem(const ParticleSystem& other) = delete;
+	ParticleSystem& operator=(const ParticleSystem& other) = delete;
+
+	/** The capacity is lowered to what the driver's limits allow. Calling it again starts over with no particles */
+	bool Init(uint32_t capacity);
+	void Release();
+
+	/** Spawned by the next Update, emitters past s_maxEmitters in a frame are dropped */
+	void Emit(const ParticleEmitter& emitter);
+	/** Pulls the particles during the next Update, with strength in px^3/s^2. Particles closer than killRad die */
+	void AddAttractor(Vec2 pos, float strength, float killRad);
+
+	/** Simulates dt seconds and spawns the emitted particles, then forgets the emitters and attractors */
+	void Update(ShaderStorage& shaders, float dt);
+	/** Additively blended over what's drawn */
+	void Draw(ShaderStorage& shaders, int w, int h);
+
+	/** Live particles after the last Update. Waits for the GPU, for tests and benchmarks */
+	uint32_t ReadCount() const;
+	inline bool IsInit() const { return m_counters != 0; }
+	inline uint32_t GetCapacity() const { return m_capacity; }
+
+	static constexpr uint32_t s_maxEmitters = 256;
+	static constexpr uint32_t s_maxAttractors = 16;	// MAX_ATTRACTORS of particleSimulate.comp
+	static constexpr uint32_t s_groupSize = 64;		// local_size_x of the compute shaders
+	static constexpr float s_drag = 0.5f;
+
+private:
+	// Layout of Emitter in particleEmit.comp
+	struct GpuEmitter
+	{
+		float pos[2], from[2], vel[2], dir[2];
+		float speed, spread, radius, life, size;
+		uint32_t color, kind, first, count, seed;
+	};
+
+	RID m_particles[2];
+	RID m_counters, m_args, m_emitters;
+	RID m_va;
+	uint32_t m_capacity;
+	uint32_t m_src;		// Buffer holding the live particles
+	std::vector<GpuEmitter> m_pending;
+	uint32_t m_pendingParticles;
+	std::vector<float> m_attractors;	// 4 floats each, as u_Attractors
+	uint32_t m_seed;
+};
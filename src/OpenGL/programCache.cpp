@@ -0,0 +1,147 @@
+#include "programCache.h"
+
+#include "../Utils/logger.h"
+#include "../Utils/fileIO.h"
+#include "../Utils/byteOrder.h"
+#include "../Utils/hash.h"
+
+#include <glad/glad.h>
+
+#include <filesystem>
+
+static constexpr char s_magic[4] = { 'H', 'P', 'P', 'B' };
+static constexpr size_t s_headerSize = sizeof(s_magic) + 4 + 8;
+
+static std::string_view GetGLString(GLenum name)
+{
+	const GLubyte* str = glGetString(name);
+	return str ? reinterpret_cast<const char*>(str) : "";
+}
+
+ProgramCache::ProgramCache()
+	: m_enabled(false),
+	m_dir(),
+	m_driverHash(0),
+	m_hits(0), m_misses(0)
+{ }
+
+bool ProgramCache::Init(const std::string& dir)
+{
+	m_enabled = false;
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (formats == 0) {
+		RENDERER_INFO("The driver has no program binary formats, shaders are always compiled from source");
+		return false;
+	}
+
+	m_dir = dir.empty() ? GetDefaultDir() : dir;
+	std::error_code err;
+	std::filesystem::create_directories(m_dir, err);
+	if (err) {
+		RENDERER_WARN(std::format("Could not create the shader cache directory {}: {}", m_dir, err.message()));
+		return false;
+	}
+
+	// Separated so that two different strings can't run together into the same text
+	m_driverHash = Hash::Fnv1a(GetGLString(GL_VENDOR));
+	m_driverHash = Hash::Fnv1a("\n", m_driverHash);
+	m_driverHash = Hash::Fnv1a(GetGLString(GL_RENDERER), m_driverHash);
+	m_driverHash = Hash::Fnv1a("\n", m_driverHash);
+	m_driverHash = Hash::Fnv1a(GetGLString(GL_VERSION), m_driverHash);
+	m_enabled = true;
+	return true;
+}
+
+RID ProgramCache::Load(std::string_view fragSrc, std::string_view vertSrc)
+{
+	if (!m_enabled)
+		return 0;
+	const uint64_t key = this->GetKey(fragSrc, vertSrc);
+	const std::string fName = this->GetFileName(key);
+
+	std::vector<uint8_t> data;
+	if (!FileIO::ReadFile(fName, data, false)) {
+		m_misses++;
+		return 0;
+	}
+	if (data.size() <= s_headerSize || memcmp(data.data(), s_magic, sizeof(s_magic)) != 0 || ByteOrder::GetLE(&data[8], 8) != key) {
+		RENDERER_WARN(std::format("Shader cache entry {} is broken, dropping it", fName));
+		// A read only cache keeps the entry, it's just never used
+		std::error_code err;
+		std::filesystem::remove(fName, err);
+		m_misses++;
+		return 0;
+	}
+
+	RID program = glCreateProgram();
+	glProgramBinary(program, static_cast<GLenum>(ByteOrder::GetLE(&data[4], 4)), data.data() + s_headerSize, static_cast<GLsizei>(data.size() - s_headerSize));
+	GLint isLinked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
+	if (isLinked == GL_FALSE) {
+		// Same strings but the driver changed anyway, the entry gets rewritten after compiling
+		RENDERER_INFO(std::format("The driver rejected cached program {}", fName));
+		glDeleteProgram(program);
+		std::error_code err;
+		std::filesystem::remove(fName, err);
+		m_misses++;
+		return 0;
+	}
+	m_hits++;
+	return program;
+}
+
+void ProgramCache::Store(RID program, std::string_view fragSrc, std::string_view vertSrc)
+{
+	if (!m_enabled || program == 0)
+		return;
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	const uint64_t key = this->GetKey(fragSrc, vertSrc);
+	std::vector<uint8_t> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+
+	std::vector<uint8_t> buf;
+	buf.reserve(s_headerSize + length);
+	for (char c : s_magic)
+		buf.push_back(static_cast<uint8_t>(c));
+	ByteOrder::PutLE(buf, format, 4);
+	ByteOrder::PutLE(buf, key, 8);
+	buf.insert(buf.end(), binary.begin(), binary.begin() + length);
+
+	// Another instance may be reading the same entry
+	FileIO::WriteFile(this->GetFileName(key), buf.data(), buf.size());
+}
+
+std::string ProgramCache::GetDefaultDir()
+{
+#ifdef _WIN32
+	if (const char* local = std::getenv("LOCALAPPDATA"))
+		return std::format("{}/HyperPong/shaderCache", local);
+#else
+	if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+		return std::format("{}/hyperpong/shaders", xdg);
+	if (const char* home = std::getenv("HOME"))
+		return std::format("{}/.cache/hyperpong/shaders", home);
+#endif
+	// Without a temporary directory either, it's relative to the working directory
+	std::error_code err;
+	const std::filesystem::path temp = std::filesystem::temp_directory_path(err);
+	return (err ? std::filesystem::path("hyperpong_shaders") : temp / "hyperpong_shaders").string();
+}
+
+uint64_t ProgramCache::GetKey(std::string_view fragSrc, std::string_view vertSrc) const
+{
+	uint64_t hash = Hash::Fnv1a(vertSrc, m_driverHash);
+	hash = Hash::Fnv1a(std::string_view("\0", 1), hash);
+	return Hash::Fnv1a(fragSrc, hash);
+}
+
+std::string ProgramCache::GetFileName(uint64_t key) const
+{
+	return std::format("{}/{:016x}.bin", m_dir, key);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+typedef uint32_t RID;
+
+/**
+ * On disk cache of linked program binaries, skips the driver's compile and link when the same sources are built again.
+ * An entry is keyed by a hash of the sources and the GL vendor, renderer and version strings, so a driver update or another
+ * GPU misses instead of loading a binary it can't use. Drivers may still reject a binary, then it's built from source again.
+ * File layout (little endian): magic "HPPB", u32 binary format, u64 key, then the binary.
+ */
+class ProgramCache
+{
+public:
+	ProgramCache();
+	~ProgramCache() = default;
+
+	/** Needs a current context, the cache stays off if the driver has no binary formats. An empty dir uses the platform's cache directory */
+	bool Init(const std::string& dir);
+	inline bool IsEnabled() const { return m_enabled; }
+	inline const std::string& GetDir() const { return m_dir; }
+
+	/** Linked program from the cache, 0 on a miss or if the driver rejected the binary */
+	RID Load(std::string_view fragSrc, std::string_view vertSrc);
+	/** The program should be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set */
+	void Store(RID program, std::string_view fragSrc, std::string_view vertSrc);
+
+	inline uint32_t GetHits() const { return m_hits; }
+	inline uint32_t GetMisses() const { return m_misses; }
+
+	static std::string GetDefaultDir();
+
+private:
+	bool m_enabled;
+	std::string m_dir;
+	uint64_t m_driverHash;
+	uint32_t m_hits, m_misses;
+private:
+	uint64_t GetKey(std::string_view fragSrc, std::string_view vertSrc) const;
+	std::string GetFileName(uint64_t key) const;
+};
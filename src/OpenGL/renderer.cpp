@@ -4,6 +4,9 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <array>
+#include <cmath>
+
 void GLAPIENTRY errorOccurredGL(GLenum source,
     GLenum type,
     GLuint id,
@@ -20,23 +23,42 @@ void GLAPIENTRY errorOccurredGL(GLenum source,
     default:
         break;
     }
+    // Compile errors are logged with the shader's info log, and an edited shader with a typo shouldn't end the game
+    if (source == GL_DEBUG_SOURCE_SHADER_COMPILER)
+        return;
     printf("OpenGL error:\nSource: 0x%x\nType: 0x%x\n"
         "Id: 0x%x\nSeverity: 0x%x\n", source, type, id, severity);
     printf("%s\n", message);
     exit(-1);
 }
 
-Renderer::Renderer(int w, int h, const char* title)
+Renderer::Renderer(int w, int h, const char* title, bool visible, const ShaderConfig& shaders)
     : m_initSuccess(false),
     m_window(nullptr),
     m_firstTimePoint(std::chrono::steady_clock::now()),
     m_lastTimePoint(std::chrono::steady_clock::now()),
     m_prevFrameTime(1.f / 60.f),
+    m_frameElapsedSecs(0.0f),
+    m_windowW(w), m_windowH(h),
+    m_viewportW(w), m_viewportH(h),
+    m_refreshRate(60.f),
     m_vb(0), m_ib(0), m_va(0),
-    m_shaderStorage()
+    m_shaderStorage(),
+    m_inputEvents(),
+    m_cursorPos({ 0.0f, 0.0f }),
+    m_droppedInputEvents(0),
+    m_counters(),
+    m_gpuTimers(),
+    m_backgroundQuality(Bg_Procedural),
+    m_noise(),
+    m_backgroundScale(1),
+    m_bgFramebuffer(0), m_bgTexture(0),
+    m_bgTargetW(0), m_bgTargetH(0),
+    m_particles()
 {
-    m_initSuccess = this->Init(w, h, title);
-    m_shaderStorage.Init();
+    m_initSuccess = this->Init(w, h, title, visible);
+    if (m_initSuccess)
+        m_shaderStorage.Init(shaders);
 
     m_firstTimePoint = std::chrono::steady_clock::now();
     m_lastTimePoint = std::chrono::steady_clock::now();
@@ -45,6 +67,10 @@ Renderer::Renderer(int w, int h, const char* title)
 Renderer::~Renderer()
 {
     if (m_initSuccess) {
+        m_gpuTimers.Release();
+        m_noise.Release();
+        this->ReleaseBackgroundTarget();
+        m_particles.Release();
         glDeleteBuffers(1, &m_vb);
         glDeleteBuffers(1, &m_ib);
         glDeleteVertexArrays(1, &m_va);
@@ -54,37 +80,60 @@ Renderer::~Renderer()
 
 bool Renderer::WindowShouldClose()
 {
-    // Calculate the frame time as well
-    std::chrono::steady_clock::time_point curTime = std::chrono::steady_clock::now();
-    auto dur = curTime - m_lastTimePoint;
-    m_lastTimePoint = curTime;
-    m_prevFrameTime = static_cast<float>(dur.count()) / 1e9f;
     return glfwWindowShouldClose(m_window);
 }
 
 float Renderer::GetElapsedSecs() const
 {
-    auto dur = m_lastTimePoint - m_firstTimePoint;
-    return static_cast<float>(dur.count()) / 1e9f;
+    return std::chrono::duration<float>(std::chrono::steady_clock::now() - m_firstTimePoint).count();
 }
 
 std::pair<int, int> Renderer::GetWindowSize() const
 {
-    int w, h;
-    glfwGetWindowSize(m_window, &w, &h);
-    return std::make_pair(w, h);
+    // Cached so that the render thread doesn't need to call into GLFW
+    return std::make_pair(m_windowW.load(std::memory_order_relaxed), m_windowH.load(std::memory_order_relaxed));
+}
+
+void Renderer::PushInputEvent(InputEventType type, int32_t code, bool down)
+{
+    const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_firstTimePoint).count();
+    // A full queue means nobody is reading, dropping is better than blocking the event loop
+    if (!m_inputEvents.TryPush({ time, m_cursorPos[0], m_cursorPos[1], code, type, down }))
+        m_droppedInputEvents++;
+}
+
+void Renderer::MakeContextCurrent()
+{
+    glfwMakeContextCurrent(m_window);
 }
 
-Vec2 Renderer::GetMousePos() const
+void Renderer::ReleaseContext()
 {
-    double x, y;
-    glfwGetCursorPos(m_window, &x, &y);
-    return Vec2({static_cast<float>(x), static_cast<float>(this->GetWindowHeight() - y)});
+    glfwMakeContextCurrent(nullptr);
 }
 
-bool Renderer::IsKeyDown(Key key)
+void Renderer::BeginFrame()
 {
-    return glfwGetKey(m_window, key) == GLFW_PRESS;
+    // Calculate the frame time
+    std::chrono::steady_clock::time_point curTime = std::chrono::steady_clock::now();
+    // Converted through duration<float> since the clock's tick length isn't necessarily a nanosecond
+    std::chrono::duration<float> dur = curTime - m_lastTimePoint;
+    m_lastTimePoint = curTime;
+    m_prevFrameTime.store(dur.count(), std::memory_order_relaxed);
+    m_frameElapsedSecs = std::chrono::duration<float>(curTime - m_firstTimePoint).count();
+
+    m_counters = RenderCounters();
+    m_gpuTimers.EndFrame();
+    m_shaderStorage.Poll();
+    m_noise.Poll(false);
+
+    // Resizes are noticed here since the callback runs on the main thread without the context
+    auto [w, h] = this->GetWindowSize();
+    if (w != m_viewportW || h != m_viewportH) {
+        glViewport(0, 0, w, h);
+        m_viewportW = w;
+        m_viewportH = h;
+    }
 }
 
 void Renderer::ClearBG(float r, float g, float b, float a)
@@ -127,21 +176,157 @@ void Renderer::BackGroundShader(BaseShader type, Vec2 highlightPos)
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)8);
 
-    m_shaderStorage.Bind(type);
-    if (type == Sh_Background) {
-        m_shaderStorage.GetShader(Sh_Background).SetUniform1f("u_Time", this->GetElapsedSecs());
-        m_shaderStorage.GetShader(Sh_Background).SetUniform2f("u_HighlightPos", highlightPos[0], highlightPos[1]);
-        m_shaderStorage.GetShader(Sh_Background).SetUniform2f("u_WindDim", static_cast<float>(wi), static_cast<float>(hi));
+    // Procedural until the texture and its shader are both there
+    if (type == Sh_Background && m_backgroundQuality == Bg_Texture && m_noise.IsReady() && m_shaderStorage.IsReady(Sh_BackgroundTex))
+        type = Sh_BackgroundTex;
+    // The noise is drawn at a fraction of the resolution and upsampled, the highlight is added at full resolution
+    const BaseShader lowResType = type == Sh_BackgroundTex ? Sh_BackgroundTexLowRes : Sh_BackgroundLowRes;
+    const bool lowRes = m_backgroundScale > 1 && (type == Sh_Background || type == Sh_BackgroundTex) &&
+        m_shaderStorage.IsReady(lowResType) && m_shaderStorage.IsReady(Sh_BackgroundUpscale);
+    if (lowRes) {
+        this->ResizeBackgroundTarget(wi, hi);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_bgFramebuffer);
+        glViewport(0, 0, m_bgTargetW, m_bgTargetH);
+        type = lowResType;
+        m_counters.stateChanges += 2;
+    }
+
+    const BaseShader bound = m_shaderStorage.Bind(type);
+    if (bound == Sh_Background || bound == Sh_BackgroundTex || (lowRes && bound == lowResType)) {
+        Shader& shader = m_shaderStorage.GetShader(bound);
+        shader.SetUniform1f("u_Time", m_frameElapsedSecs);
+        shader.SetUniform2f("u_WindDim", static_cast<float>(wi), static_cast<float>(hi));
+        m_counters.stateChanges += 2;
+    }
+    if (bound == Sh_Background || bound == Sh_BackgroundTex) {
+        m_shaderStorage.GetShader(bound).SetUniform2f("u_HighlightPos", highlightPos[0], highlightPos[1]);
+        m_counters.stateChanges++;
+    }
+    if (bound == Sh_BackgroundTex || bound == Sh_BackgroundTexLowRes) {
+        glBindTextureUnit(0, m_noise.GetTexture());
+        m_shaderStorage.GetShader(bound).SetUniform1i("u_Noise", 0);
+        m_shaderStorage.GetShader(bound).SetUniform1f("u_NoisePeriod", static_cast<float>(NoiseTexture::s_period));
+        m_counters.stateChanges += 3;
     }
     glBindVertexArray(m_va);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ib);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+    m_counters.drawCalls++;
+    m_counters.stateChanges += 3;
+    if (!lowRes)
+        return;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, m_viewportW, m_viewportH);
+    m_shaderStorage.Bind(Sh_BackgroundUpscale);
+    Shader& upscale = m_shaderStorage.GetShader(Sh_BackgroundUpscale);
+    glBindTextureUnit(0, m_bgTexture);
+    upscale.SetUniform1i("u_Background", 0);
+    upscale.SetUniform2f("u_HighlightPos", highlightPos[0], highlightPos[1]);
+    upscale.SetUniform2f("u_WindDim", static_cast<float>(wi), static_cast<float>(hi));
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+    m_counters.drawCalls++;
+    m_counters.stateChanges += 7;
+}
+
+void Renderer::SetBackgroundScale(uint32_t scale)
+{
+    m_backgroundScale = std::max(scale, 1u);
+}
+
+void Renderer::ResizeBackgroundTarget(int w, int h)
+{
+    // Rounded up so the last row and column of pixels still has texels
+    const int targetW = (w + static_cast<int>(m_backgroundScale) - 1) / static_cast<int>(m_backgroundScale);
+    const int targetH = (h + static_cast<int>(m_backgroundScale) - 1) / static_cast<int>(m_backgroundScale);
+    if (m_bgFramebuffer != 0 && targetW == m_bgTargetW && targetH == m_bgTargetH)
+        return;
+    this->ReleaseBackgroundTarget();
+    m_bgTargetW = targetW;
+    m_bgTargetH = targetH;
+
+    // Immutable storage, a resize makes a new texture
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_bgTexture);
+    glTextureStorage2D(m_bgTexture, 1, GL_RGBA8, targetW, targetH);
+    glTextureParameteri(m_bgTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(m_bgTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(m_bgTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_bgTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glCreateFramebuffers(1, &m_bgFramebuffer);
+    glNamedFramebufferTexture(m_bgFramebuffer, GL_COLOR_ATTACHMENT0, m_bgTexture, 0);
+    if (glCheckNamedFramebufferStatus(m_bgFramebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        RENDERER_ERROR(std::format("Background framebuffer of {}x{} is incomplete", targetW, targetH));
+}
+
+void Renderer::ReleaseBackgroundTarget()
+{
+    glDeleteFramebuffers(1, &m_bgFramebuffer);
+    glDeleteTextures(1, &m_bgTexture);
+    m_bgFramebuffer = 0;
+    m_bgTexture = 0;
+}
+
+void Renderer::SetBackgroundQuality(BackgroundQuality quality)
+{
+    m_backgroundQuality = quality;
+    if (quality == Bg_Texture)
+        m_noise.Start();
+}
+
+void Renderer::SetParticleCapacity(uint32_t capacity)
+{
+    if (capacity == 0) {
+        m_particles.Release();
+        return;
+    }
+    if (m_shaderStorage.GetGLVersion() < ShaderStorage::GetDesc(Sh_ParticleSimulate).glVersion) {
+        RENDERER_WARN(std::format("Particles need OpenGL 4.3, the context is {}.{}, they are off", m_shaderStorage.GetGLVersion() / 100, m_shaderStorage.GetGLVersion() / 10 % 10));
+        return;
+    }
+    m_particles.Init(capacity);
+}
+
+void Renderer::DrawParticles(float dt)
+{
+    if (!m_particles.IsInit())
+        return;
+    auto [wi, hi] = this->GetWindowSize();
+    m_particles.Update(m_shaderStorage, dt);
+    m_particles.Draw(m_shaderStorage, wi, hi);
+    m_counters.drawCalls++;
+    m_counters.stateChanges += 4;
 }
 
-void Renderer::SwapAndPoll()
+const char* Renderer::GetQualityName(BackgroundQuality quality)
+{
+    switch (quality) {
+    case Bg_Procedural:
+        return "procedural";
+    case Bg_Texture:
+        return "texture";
+    default:
+        return "unknown";
+    }
+}
+
+void Renderer::Swap()
 {
     /* Swap front and back buffers */
     glfwSwapBuffers(m_window);
+}
+
+void Renderer::WaitForPresent()
+{
+    glFinish();
+}
+
+void Renderer::SetSwapInterval(int interval)
+{
+    glfwSwapInterval(interval);
+}
+
+void Renderer::PollEvents()
+{
     /* Poll for and process events */
     glfwPollEvents();
 }
@@ -181,11 +366,13 @@ void Renderer::DrawRect(Vec2 llPix, Vec2 urPix, Vec4 c)
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)8);
 
-    m_shaderStorage.Bind(Sh_ColorFill);
-    m_shaderStorage.GetShader(Sh_ColorFill).SetUniform4f("u_Color", c[0], c[1], c[2], c[3]);
+    if (m_shaderStorage.Bind(Sh_ColorFill) == Sh_ColorFill)
+        m_shaderStorage.GetShader(Sh_ColorFill).SetUniform4f("u_Color", c[0], c[1], c[2], c[3]);
     glBindVertexArray(m_va);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ib);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+    m_counters.drawCalls++;
+    m_counters.stateChanges += 4;
 }
 
 void Renderer::DrawRectSh(Vec2 llPix, Vec2 urPix, BaseShader sh)
@@ -223,20 +410,118 @@ void Renderer::DrawRectSh(Vec2 llPix, Vec2 urPix, BaseShader sh)
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)8);
 
-    m_shaderStorage.Bind(sh);
-    if (sh == Sh_BlackHole)
-        m_shaderStorage.GetShader(Sh_BlackHole).SetUniform1f("u_Time", this->GetElapsedSecs());
+    const BaseShader bound = m_shaderStorage.Bind(sh);
+    if (bound == Sh_BlackHole || bound == Sh_BlackHoleDisc) {
+        m_shaderStorage.GetShader(bound).SetUniform1f("u_Time", m_frameElapsedSecs);
+        m_counters.stateChanges++;
+    }
     glBindVertexArray(m_va);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ib);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+    m_counters.drawCalls++;
+    m_counters.stateChanges += 3;
+}
+
+void Renderer::DrawDiscSh(Vec2 centerPix, float radPix, BaseShader sh)
+{
+    // Unit directions of the corners, circumscribed so the edges touch the circle and none of it is cut off
+    static const std::array<std::pair<float, float>, s_discSides> corners = []() {
+        std::array<std::pair<float, float>, s_discSides> out;
+        const float step = 6.28318530718f / s_discSides;
+        const float outer = 1.0f / std::cos(step * 0.5f);
+        for (uint32_t i = 0; i < s_discSides; i++)
+            out[i] = { std::cos(step * i) * outer, std::sin(step * i) * outer };
+        return out;
+    }();
+    // A big triangle in the middle and each arc split at its middle, instead of thin triangles fanning out from the center.
+    // GPUs shade 2x2 pixel blocks, the ones on an edge between triangles are shaded for both, so shorter inner edges waste less.
+    static const std::array<uint32_t, (s_discSides - 2) * 3> indices = []() {
+        std::array<uint32_t, (s_discSides - 2) * 3> out;
+        size_t count = 0;
+        auto split = [&](auto& self, uint32_t first, uint32_t last) -> void {
+            if (last - first < 2)
+                return;
+            const uint32_t mid = (first + last) / 2;
+            out[count++] = first;
+            out[count++] = mid;
+            out[count++] = last % s_discSides;
+            self(self, first, mid);
+            self(self, mid, last);
+        };
+        const uint32_t a = s_discSides / 3, b = 2 * s_discSides / 3;
+        out[count++] = 0;
+        out[count++] = a;
+        out[count++] = b;
+        split(split, 0, a);
+        split(split, a, b);
+        split(split, b, s_discSides);
+        return out;
+    }();
+
+    auto [wi, hi] = this->GetWindowSize();
+    const float cx = centerPix[0] * 2.0f / wi - 1.0f, cy = centerPix[1] * 2.0f / hi - 1.0f;
+    const float rx = radPix * 2.0f / wi, ry = radPix * 2.0f / hi;
+
+    // Texture coordinates span [0, 1] over the circle like they do over DrawRectSh's quad
+    float vertices[s_discSides * 4];
+    for (uint32_t i = 0; i < s_discSides; i++) {
+        const auto [ux, uy] = corners[i];
+        vertices[i * 4] = cx + ux * rx;
+        vertices[i * 4 + 1] = cy + uy * ry;
+        vertices[i * 4 + 2] = 0.5f + 0.5f * ux;
+        vertices[i * 4 + 3] = 0.5f + 0.5f * uy;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vb);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ib);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices.data(), GL_STATIC_DRAW);
+
+    glBindVertexArray(m_va);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)8);
+
+    const BaseShader bound = m_shaderStorage.Bind(sh);
+    if (bound == Sh_BlackHole || bound == Sh_BlackHoleDisc) {
+        m_shaderStorage.GetShader(bound).SetUniform1f("u_Time", m_frameElapsedSecs);
+        m_counters.stateChanges++;
+    }
+    glBindVertexArray(m_va);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ib);
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, nullptr);
+    m_counters.drawCalls++;
+    m_counters.stateChanges += 3;
 }
 
 void WindResizeCallback(GLFWwindow* wnd, int32_t w, int32_t h) {
-    glViewport(0, 0, w, h);
+    Renderer* rend = static_cast<Renderer*>(glfwGetWindowUserPointer(wnd));
+    rend->m_windowW = w;
+    rend->m_windowH = h;
     RENDERER_INFO(std::format("Window resized, new size {}x{}", w, h));
 }
 
-bool Renderer::Init(int w, int h, const char* title)
+void KeyCallback(GLFWwindow* wnd, int32_t key, int32_t scancode, int32_t action, int32_t mods) {
+    if (action == GLFW_REPEAT)
+        return;
+    Renderer* rend = static_cast<Renderer*>(glfwGetWindowUserPointer(wnd));
+    rend->PushInputEvent(Ev_Key, key, action == GLFW_PRESS);
+}
+
+void MouseButtonCallback(GLFWwindow* wnd, int32_t button, int32_t action, int32_t mods) {
+    Renderer* rend = static_cast<Renderer*>(glfwGetWindowUserPointer(wnd));
+    rend->PushInputEvent(Ev_MouseButton, button, action == GLFW_PRESS);
+}
+
+void CursorPosCallback(GLFWwindow* wnd, double x, double y) {
+    Renderer* rend = static_cast<Renderer*>(glfwGetWindowUserPointer(wnd));
+    rend->m_cursorPos = Vec2({ static_cast<float>(x), static_cast<float>(rend->GetWindowHeight() - y) });
+    rend->PushInputEvent(Ev_MouseMove, 0, false);
+}
+
+bool Renderer::Init(int w, int h, const char* title, bool visible)
 {
     /* Initialize the library */
     if (glfwInit() == GLFW_FALSE)
@@ -251,6 +536,7 @@ bool Renderer::Init(int w, int h, const char* title)
 
     glfwWindowHint(GLFW_POSITION_X, 80);
     glfwWindowHint(GLFW_POSITION_Y, 80);
+    glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
    
     /* Create a windowed mode window and its OpenGL context */
     m_window = glfwCreateWindow(w, h, title, NULL, NULL);
@@ -262,8 +548,11 @@ bool Renderer::Init(int w, int h, const char* title)
     /* Make the window's context current */
     glfwMakeContextCurrent(m_window);
 
-    //Framerate
+    // VSync by default, the render thread sets its own pacing
     glfwSwapInterval(1);
+    const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    if (mode && mode->refreshRate > 0)
+        m_refreshRate = static_cast<float>(mode->refreshRate);
 
     // Load modern OpenGL using glad
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
@@ -287,8 +576,17 @@ bool Renderer::Init(int w, int h, const char* title)
     glGenBuffers(1, &m_vb);
     glGenBuffers(1, &m_ib);
     glCreateVertexArrays(1, &m_va);
+    m_gpuTimers.Init();
 
+    glfwSetWindowUserPointer(m_window, this);
     glfwSetWindowSizeCallback(m_window, WindResizeCallback);
+    glfwSetKeyCallback(m_window, KeyCallback);
+    glfwSetMouseButtonCallback(m_window, MouseButtonCallback);
+    glfwSetCursorPosCallback(m_window, CursorPosCallback);
+    // The cursor is only reported when it moves, start from where it is
+    double cursX, cursY;
+    glfwGetCursorPos(m_window, &cursX, &cursY);
+    m_cursorPos = Vec2({ static_cast<float>(cursX), static_cast<float>(h - cursY) });
 
     return true;
 }
\ No newline at end of file
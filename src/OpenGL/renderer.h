@@ -3,14 +3,37 @@
 #include "../Utils/matrix.h"
 #include "shader.h"
 #include "keys.h"
+#include "input.h"
+#include "gpuTimer.h"
+#include "noiseTexture.h"
+#include "particles.h"
+#include "../Utils/spscQueue.h"
+
+#include <atomic>
 
 struct GLFWwindow;
 typedef uint32_t RID;
 
+/** How the background's noise is made, from the most to the least GPU work */
+enum BackgroundQuality
+{
+	Bg_Procedural = 0,	// Three octaves of gradient noise per pixel
+	Bg_Texture,			// Read from a precomputed tileable noise texture
+	BackgroundQuality_COUNT
+};
+
+/** Work submitted since the frame began */
+struct RenderCounters
+{
+	uint32_t drawCalls = 0;
+	uint32_t stateChanges = 0;	// Program binds, uniform updates and buffer uploads
+};
+
 class Renderer
 {
 public:
-	Renderer(int w, int h, const char* title);
+	/** A hidden window still has a working context and framebuffer, for headless rendering */
+	Renderer(int w, int h, const char* title, bool visible = true, const ShaderConfig& shaders = {});
 	~Renderer();
 
 	inline bool IsInitSuccess() const { return m_initSuccess; }
@@ -20,35 +43,103 @@ public:
 	// * Queries *
 
 	bool WindowShouldClose();
-	inline float GetFrameTime() const { return m_prevFrameTime; }
+	inline float GetFrameTime() const { return m_prevFrameTime.load(std::memory_order_relaxed); }
 	float GetElapsedSecs() const;
 	std::pair<int, int> GetWindowSize() const;
 	inline int GetWindowWidth() const { auto [w, h] = GetWindowSize(); return w; }
 	inline int GetWindowHeight() const { auto [w, h] = GetWindowSize(); return h; }
+	inline float GetRefreshRate() const { return m_refreshRate; }
+	inline BackgroundQuality GetBackgroundQuality() const { return m_backgroundQuality; }
+	inline uint32_t GetBackgroundScale() const { return m_backgroundScale; }
+	static const char* GetQualityName(BackgroundQuality quality);
 
-	Vec2 GetMousePos() const;
+	/** Input events in the order they happened, filled by the window callbacks during PollEvents */
+	inline bool PopInputEvent(InputEvent& out) { return m_inputEvents.TryPop(out); }
+	inline uint64_t GetDroppedInputEvents() const { return m_droppedInputEvents; }
 
-	bool IsKeyDown(Key key);
+	inline const RenderCounters& GetCounters() const { return m_counters; }
+	/** Of a frame a few frames back, the newest one the GPU has finished */
+	inline float GetGpuPassMs(GpuPass pass) const { return m_gpuTimers.GetMs(pass); }
+
+	// * Threading *
+	// The GL context is current on one thread at a time, everything below Setters must be called from that thread.
+	// Events and input have to be handled on the main thread.
+
+	void MakeContextCurrent();
+	void ReleaseContext();
 
 	// * Setters *
 
+	void BeginFrame();
 	void ClearBG(float r, float g, float b, float a = 1.0f);
+	/** GPU time is measured for one pass at a time, beginning a pass ends the previous one */
+	inline void BeginGpuPass(GpuPass pass) { m_gpuTimers.Begin(pass); }
+	inline void EndGpuPass() { m_gpuTimers.End(); }
+	/** At Bg_Texture, Sh_Background is drawn as Sh_BackgroundTex once the noise texture is ready */
 	void BackGroundShader(BaseShader type, Vec2 highlightPos);
+	/** The noise texture is generated in the background the first time Bg_Texture is set */
+	void SetBackgroundQuality(BackgroundQuality quality);
+	/** The background is drawn at 1 / scale of the window's resolution in each direction and upsampled, 1 draws it directly */
+	void SetBackgroundScale(uint32_t scale);
 
-	void SwapAndPoll();
+	void Swap();
+	/** Blocks until the swapped frame is on screen, so the present time can be measured */
+	void WaitForPresent();
+	void SetSwapInterval(int interval);
+	void PollEvents();
 
 	void DrawRect(Vec2 ll, Vec2 ur, Vec4 c = Vec4({1.f, 1.f, 1.f, 1.f}));
     void DrawRectSh(Vec2 ll, Vec2 ur, BaseShader sh);
+    /** For radial effects, a polygon just around the circle shades about a fifth fewer pixels than the square around it */
+    void DrawDiscSh(Vec2 center, float rad, BaseShader sh);
+
+    /** 0 turns the particles off, they need GL 4.3 and stay off below it */
+    void SetParticleCapacity(uint32_t capacity);
+    /** Emitters and attractors are used by the next DrawParticles */
+    inline void EmitParticles(const ParticleEmitter& emitter) { m_particles.Emit(emitter); }
+    inline void AddParticleAttractor(Vec2 pos, float strength, float killRad) { m_particles.AddAttractor(pos, strength, killRad); }
+    /** Advances the particles by dt and draws them */
+    void DrawParticles(float dt);
+    inline const ParticleSystem& GetParticles() const { return m_particles; }
 
-    inline void ResetShaders() { m_shaderStorage.Init(); }
+    inline void ResetShaders() { m_shaderStorage.Reload(); }
+    /** Shaders build in the background, draws use Sh_WhiteFill for the ones that aren't ready */
+    inline bool HasShader(BaseShader type) const { return m_shaderStorage.IsReady(type); }
+    /** Waits for every shader, and for the noise texture if it's being generated */
+    inline void FinishShaders() { m_shaderStorage.Finish(); m_noise.Poll(true); }
 
 private:
 	bool m_initSuccess;
 	GLFWwindow* m_window;
 	std::chrono::steady_clock::time_point m_firstTimePoint, m_lastTimePoint;
-	float m_prevFrameTime;
+	std::atomic<float> m_prevFrameTime;
+	float m_frameElapsedSecs;
+	std::atomic<int> m_windowW, m_windowH;	// Written by the resize callback on the main thread
+	int m_viewportW, m_viewportH;
+	float m_refreshRate;	// Of the primary monitor, Hz
 	RID m_vb, m_ib, m_va;
 	ShaderStorage m_shaderStorage;
+	SpscQueue<InputEvent, 1024> m_inputEvents;	// Window callbacks push, the simulation pops
+	Vec2 m_cursorPos;
+	uint64_t m_droppedInputEvents;
+	RenderCounters m_counters;
+	GpuTimers m_gpuTimers;
+	BackgroundQuality m_backgroundQuality;
+	NoiseTexture m_noise;
+	uint32_t m_backgroundScale;
+	RID m_bgFramebuffer, m_bgTexture;	// Low resolution target of the background, made on first use
+	int m_bgTargetW, m_bgTargetH;
+	ParticleSystem m_particles;
+
+	static constexpr uint32_t s_discSides = 16;
 private:
-	bool Init(int w, int h, const char* title);
+	bool Init(int w, int h, const char* title, bool visible);
+	void PushInputEvent(InputEventType type, int32_t code, bool down);
+	void ResizeBackgroundTarget(int w, int h);
+	void ReleaseBackgroundTarget();
+
+	friend void WindResizeCallback(GLFWwindow* wnd, int32_t w, int32_t h);
+	friend void KeyCallback(GLFWwindow* wnd, int32_t key, int32_t scancode, int32_t action, int32_t mods);
+	friend void MouseButtonCallback(GLFWwindow* wnd, int32_t button, int32_t action, int32_t mods);
+	friend void CursorPosCallback(GLFWwindow* wnd, double x, double y);
 };
\ No newline at end of file
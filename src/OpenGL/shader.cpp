@@ -1,51 +1,121 @@
 #include "shader.h"
 
 #include "../Utils/logger.h"
+#include "../Utils/fileIO.h"
+#include "embeddedShaders.h"
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+// KHR_parallel_shader_compile isn't in our GL loader
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+// Set once per context by EnableParallelCompile
+static bool s_hasCompletionStatus = false;
+
 Shader::Shader()
-	: m_id(0)
+	: m_id(0),
+	m_UniformLocationCache(),
+	m_pending()
 { }
 
 Shader::~Shader()
 {
 	glDeleteProgram(m_id);
+	this->DropPending();
 }
 
-void Shader::Init(const std::string& fragFile)
+// For shaders built without a vertex shader of their own
+static constexpr std::string_view s_quadVertSrc = EmbeddedShaders::Find("quad.vert");
+
+void Shader::InitFromSource(std::string_view fragSrc, std::string_view vertSrc, ProgramCache* cache)
 {
-	std::string fragSrc;
-	if (!this->LoadFileToString(fragSrc, fragFile))
-		return;
-	std::string vertSrc = R"(
-#version 330 core
+	this->BeginFromSource(fragSrc, vertSrc, cache);
+	this->Poll(true);
+}
 
-layout(location = 0) in vec3 a_Position;
-layout(location = 1) in vec2 a_TexCoord;
+void Shader::BeginFromSource(std::string_view fragSrc, std::string_view vertSrc, ProgramCache* cache)
+{
+	if (vertSrc.empty())
+		vertSrc = s_quadVertSrc;
+	// A newer build replaces one still in flight
+	this->DropPending();
+
+	if (cache) {
+		const RID cached = cache->Load(fragSrc, vertSrc);
+		if (cached != 0) {
+			this->SetProgram(cached);
+			return;
+		}
+	}
+	m_pending = this->SubmitProgram(fragSrc, vertSrc, cache != nullptr);
+	m_pending.cache = cache;
+}
 
-out vec3 v_Position;
-out vec2 v_TexCoord;
+void Shader::InitComputeFromSource(std::string_view compSrc, ProgramCache* cache)
+{
+	this->BeginComputeFromSource(compSrc, cache);
+	this->Poll(true);
+}
 
-void main() {
-	v_Position = a_Position;
-	v_TexCoord = a_TexCoord;
-	gl_Position = vec4(a_Position, 1.0);
+void Shader::BeginComputeFromSource(std::string_view compSrc, ProgramCache* cache)
+{
+	this->DropPending();
+	// Keyed without a vertex source, which a graphics program always has
+	if (cache) {
+		const RID cached = cache->Load(compSrc, {});
+		if (cached != 0) {
+			this->SetProgram(cached);
+			return;
+		}
+	}
+	m_pending = this->SubmitCompute(compSrc, cache != nullptr);
+	m_pending.cache = cache;
 }
-)";
 
-	m_id = this->CreateShader(fragSrc, vertSrc);
+bool Shader::Poll(bool wait)
+{
+	if (!this->IsPending())
+		return true;
+	if (!wait && s_hasCompletionStatus) {
+		GLint done = GL_FALSE;
+		glGetProgramiv(m_pending.program, GL_COMPLETION_STATUS_KHR, &done);
+		if (done == GL_FALSE)
+			return false;
+	}
+
+	PendingProgram pending = std::move(m_pending);
+	m_pending = PendingProgram();
+	const RID program = this->FinishProgram(pending);
+	// A failed build keeps the previous program, so a typo while editing doesn't blank the effect
+	if (program == 0)
+		return true;
+	if (pending.cache)
+		pending.cache->Store(program, pending.fragSrc, pending.vertSrc);
+	this->SetProgram(program);
+	return true;
 }
 
-void Shader::Init(const std::string& fragFile, const std::string& vertFile)
+bool Shader::EnableParallelCompile()
 {
-	std::string fragSrc;
-	bool fRead = this->LoadFileToString(fragSrc, fragFile);
-	std::string vertSrc;
-	bool vRead = this->LoadFileToString(vertSrc, vertFile);
-	if (fRead && vRead)
-		m_id = this->CreateShader(fragSrc, vertSrc);
+	s_hasCompletionStatus = false;
+	const char* names[][2] = {
+		{ "GL_KHR_parallel_shader_compile", "glMaxShaderCompilerThreadsKHR" },
+		{ "GL_ARB_parallel_shader_compile", "glMaxShaderCompilerThreadsARB" }
+	};
+	for (auto [ext, func] : names) {
+		if (!glfwExtensionSupported(ext))
+			continue;
+		// The driver picks the thread count
+		auto maxThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(glfwGetProcAddress(func));
+		if (maxThreads)
+			maxThreads(0xFFFFFFFF);
+		s_hasCompletionStatus = true;
+		return true;
+	}
+	return false;
 }
 
 
@@ -64,6 +134,11 @@ void Shader::SetUniform1i(const std::string& name, int32_t v)
 	glUniform1i(GetUniformLocation(name), v);
 }
 
+void Shader::SetUniform1ui(const std::string& name, uint32_t v)
+{
+	glUniform1ui(GetUniformLocation(name), v);
+}
+
 void Shader::SetUniform1f(const std::string& name, float v)
 {
 	glUniform1f(GetUniformLocation(name), v);
@@ -79,99 +154,139 @@ void Shader::SetUniform4f(const std::string& name, float v0, float v1, float v2,
 	glUniform4f(GetUniformLocation(name), v0, v1, v2, v3);
 }
 
+void Shader::SetUniform4fv(const std::string& name, uint32_t count, const float* v)
+{
+	glUniform4fv(GetUniformLocation(name), static_cast<GLsizei>(count), v);
+}
+
 void Shader::SetUniformMat4f(const std::string& name, const float* mat)
 {
 	glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, mat);
 }
 
-bool Shader::LoadFileToString(std::string& outBuf, const std::string& fName)
+void Shader::SetProgram(RID program)
 {
-	outBuf.clear();
-	std::ifstream file(fName);
-	if (!file) {
-		RENDERER_ERROR(std::format("Could not open file {}", fName));
-		return false;
-	}
-	std::string line;
-	while (file.good()) {
-		std::getline(file, line);
-		outBuf += line += "\n";
-	}
-	if (file.fail())
-		RENDERER_ERROR(std::format("File {} was left in bad state after reading", fName));
-	
-	return !file.fail();
+	glDeleteProgram(m_id);
+	m_id = program;
+	// Locations belong to the program, the new one may have them elsewhere or not at all
+	m_UniformLocationCache.clear();
 }
 
-RID Shader::CreateShader(const std::string& fragSrc, const std::string& vertSrc)
+Shader::PendingProgram Shader::SubmitProgram(std::string_view fragSrc, std::string_view vertSrc, bool retrievable)
 {
-	RID vs = CompileShader(GL_VERTEX_SHADER, vertSrc);
-	RID fs = CompileShader(GL_FRAGMENT_SHADER, fragSrc);
-	if (vs == 0 || fs == 0)
-		return 0;
+	// Nothing is asked from the driver here, so a driver compiling on its own threads can get on with it
+	PendingProgram pending;
+	pending.vs = CompileShader(GL_VERTEX_SHADER, vertSrc);
+	pending.fs = CompileShader(GL_FRAGMENT_SHADER, fragSrc);
+	pending.fragSrc = fragSrc;
+	pending.vertSrc = vertSrc;
+
+	pending.program = glCreateProgram();
+	glAttachShader(pending.program, pending.vs);
+	glAttachShader(pending.program, pending.fs);
+	if (retrievable)
+		glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(pending.program);
+	return pending;
+}
 
-	RID program = glCreateProgram();
-	glAttachShader(program, vs);
-	glAttachShader(program, fs);
-	glLinkProgram(program);
+Shader::PendingProgram Shader::SubmitCompute(std::string_view compSrc, bool retrievable)
+{
+	PendingProgram pending;
+	pending.cs = CompileShader(GL_COMPUTE_SHADER, compSrc);
+	pending.fragSrc = compSrc;
+
+	pending.program = glCreateProgram();
+	glAttachShader(pending.program, pending.cs);
+	if (retrievable)
+		glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(pending.program);
+	return pending;
+}
+
+void Shader::DropPending()
+{
+	if (!this->IsPending())
+		return;
+	glDeleteProgram(m_pending.program);
+	glDeleteShader(m_pending.vs);
+	glDeleteShader(m_pending.fs);
+	glDeleteShader(m_pending.cs);
+	m_pending = PendingProgram();
+}
+
+RID Shader::FinishProgram(PendingProgram& pending)
+{
+	RID program = pending.program;
+	const bool compiled = pending.cs != 0 ? CheckCompile(pending.cs, GL_COMPUTE_SHADER) :
+		CheckCompile(pending.vs, GL_VERTEX_SHADER) & CheckCompile(pending.fs, GL_FRAGMENT_SHADER);
 
 	int isLinked = 0;
-	glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
-	if (isLinked == GL_FALSE)
+	if (compiled)
+		glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
+	if (compiled && isLinked == GL_FALSE)
 	{
 		GLint maxLength = 0;
 		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
 
 		// The maxLength includes the NULL character
-		std::vector<GLchar> infoLog(maxLength);
+		std::vector<GLchar> infoLog(maxLength + 1);
 		glGetProgramInfoLog(program, maxLength, &maxLength, &infoLog[0]);
+		RENDERER_ERROR(infoLog.data());
+	}
 
+	if (isLinked == GL_FALSE) {
 		// We don't need the program anymore.
 		glDeleteProgram(program);
-		// Don't leak shaders either.
-		glDeleteShader(vs);
-		glDeleteShader(fs);
-
-		RENDERER_ERROR(infoLog.data());
-
-		return 0;
+		program = 0;
+	} else {
+		glValidateProgram(program);
+		if (pending.cs != 0) {
+			glDetachShader(program, pending.cs);
+		} else {
+			glDetachShader(program, pending.vs);
+			glDetachShader(program, pending.fs);
+		}
 	}
-
-	glValidateProgram(program);
-
-	glDetachShader(program, vs);
-	glDetachShader(program, fs);
-	glDeleteShader(vs);
-	glDeleteShader(fs);
+	// Don't leak shaders either.
+	glDeleteShader(pending.vs);
+	glDeleteShader(pending.fs);
+	glDeleteShader(pending.cs);
+	// The sources and the cache stay, Poll stores the binary with them
+	pending.program = pending.vs = pending.fs = pending.cs = 0;
 
 	return program;
 }
 
-RID Shader::CompileShader(uint32_t type, const std::string& src)
+RID Shader::CompileShader(uint32_t type, std::string_view src)
 {
 	RID id = glCreateShader(type);
 	const char* str = src.data();
-	glShaderSource(id, 1, &str, nullptr);
+	const GLint length = static_cast<GLint>(src.size());
+	glShaderSource(id, 1, &str, &length);
 	glCompileShader(id);
+	return id;
+}
 
+bool Shader::CheckCompile(RID id, uint32_t type)
+{
 	//Error handling
 	int32_t result;
 	glGetShaderiv(id, GL_COMPILE_STATUS, &result);
 	if (result == GL_FALSE) {
 		int32_t length;
 		glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
-		std::vector<GLchar> infoLog(length);
+		std::vector<GLchar> infoLog(length + 1);
 		glGetShaderInfoLog(id, length, &length, &infoLog[0]);
-		glDeleteShader(id);
 
-		const char* typeStr = (type == GL_VERTEX_SHADER ? "vertex" : "fragment");
+		const char* typeStr = (type == GL_VERTEX_SHADER ? "vertex" : type == GL_COMPUTE_SHADER ? "compute" : "fragment");
 		RENDERER_ERROR(std::format("Failed to compile {} shader!", typeStr));
 		RENDERER_ERROR(infoLog.data());
 
-		return 0;
+		return false;
 	}
 
-	return id;
+	return true;
 }
 
 uint32_t Shader::GetUniformLocation(const std::string& name)
@@ -190,28 +305,135 @@ uint32_t Shader::GetUniformLocation(const std::string& name)
 // *** ShaderStorage *** //
 
 ShaderStorage::ShaderStorage()
-	: m_shaders(BaseShader_COUNT)
+	: m_shaders(BaseShader_COUNT),
+	m_config(),
+	m_cache(),
+	m_parallelCompile(false),
+	m_reloadStart(),
+	m_watcher(),
+	m_preprocessor([this](const std::string& name, std::string& out) { return GetSource(name, m_config.overrideDir, out); }),
+	m_deps(BaseShader_COUNT),
+	m_glVersion(0)
+{
+}
+
+void ShaderStorage::Init(const ShaderConfig& config)
+{
+	m_config = config;
+	if (m_config.useCache)
+		m_cache.Init(m_config.cacheDir);
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	m_glVersion = static_cast<uint32_t>(major * 100 + minor * 10);
+	m_parallelCompile = Shader::EnableParallelCompile();
+	RENDERER_INFO(m_parallelCompile ? "Shaders compile in parallel in the background" : "No parallel shader compiles, shaders are finished one per frame");
+	this->Reload();
+	if (!m_config.overrideDir.empty())
+		m_watcher.Start(m_config.overrideDir);
+}
+
+void ShaderStorage::Reload()
+{
+	ProgramCache* cache = m_cache.IsEnabled() ? &m_cache : nullptr;
+	const uint32_t hits = m_cache.GetHits(), misses = m_cache.GetMisses();
+	// Files are read again, shaders whose files didn't change get their sources from the preprocessor's cache
+	m_preprocessor.ForgetFiles();
+	m_reloadStart = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < BaseShader_COUNT; i++)
+		this->Rebuild(i);
+	// The fallback for the rest, it's tiny
+	m_shaders[Sh_WhiteFill].Poll(true);
+	if (cache)
+		RENDERER_INFO(std::format("Shader cache in {}: {} hits, {} misses", m_cache.GetDir(), m_cache.GetHits() - hits, m_cache.GetMisses() - misses));
+}
+
+bool ShaderStorage::GetSource(const std::string& fName, const std::string& overrideDir, std::string& outSrc)
 {
+	if (!overrideDir.empty()) {
+		if (FileIO::ReadFile(std::format("{}/{}", overrideDir, fName), outSrc, false))
+			return true;
+		RENDERER_WARN(std::format("{} is not in {}, using the embedded one", fName, overrideDir));
+	}
+	const std::string_view src = EmbeddedShaders::Find(fName);
+	if (src.empty()) {
+		RENDERER_ERROR(std::format("No shader {} was embedded", fName));
+		return false;
+	}
+	outSrc = src;
+	return true;
 }
 
-void ShaderStorage::Init()
+void ShaderStorage::Poll()
 {
+	std::vector<bool> changed(BaseShader_COUNT, false);
+	for (FileWatcher::Change& change : m_watcher.TakeChanges()) {
+		RENDERER_INFO(std::format("{} changed", change.name));
+		for (size_t i = 0; i < BaseShader_COUNT; i++) {
+			if (std::find(m_deps[i].begin(), m_deps[i].end(), change.name) != m_deps[i].end())
+				changed[i] = true;
+		}
+		m_preprocessor.SetFile(change.name, std::move(change.contents));
+	}
 	for (size_t i = 0; i < BaseShader_COUNT; i++) {
-		auto [fragFile, vertFile] = s_baseShaderPaths[i];
-		// Check if there even is a vertex file defined
-		if (*vertFile != 0) {
-			m_shaders[i].Init(fragFile, vertFile);
-		} else {
-			m_shaders[i].Init(fragFile);
+		if (changed[i]) {
+			m_reloadStart = std::chrono::steady_clock::now();
+			this->Rebuild(i);
 		}
 	}
+
+	bool pending = false, finished = false;
+	for (Shader& shader : m_shaders) {
+		if (!shader.IsPending())
+			continue;
+		// Without a completion query finishing blocks, so the stalls are spread over frames
+		if ((m_parallelCompile || !finished) && shader.Poll(!m_parallelCompile))
+			finished = true;
+		else
+			pending = true;
+	}
+	if (finished && !pending) {
+		const float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - m_reloadStart).count();
+		RENDERER_INFO(std::format("Shader builds finished in {:.1f}ms", ms));
+	}
+}
+
+void ShaderStorage::Rebuild(size_t index)
+{
+	const BaseShaderDesc& desc = s_baseShaders[index];
+	// Not ready, so whatever uses it is skipped
+	if (desc.glVersion > m_glVersion)
+		return;
+	const bool isCompute = *desc.vertFile == 0;
+	std::string src, vertSrc;
+	std::vector<std::string> deps;
+	// On failure the previous files stay watched, fixing them brings the shader back
+	if (!m_preprocessor.Process(desc.file, desc.defines, src, &deps) ||
+		(!isCompute && !m_preprocessor.Process(desc.vertFile, desc.defines, vertSrc, &deps)))
+		return;
+	m_deps[index] = std::move(deps);
+	// Everything is submitted before anything is waited on
+	ProgramCache* cache = m_cache.IsEnabled() ? &m_cache : nullptr;
+	if (isCompute)
+		m_shaders[index].BeginComputeFromSource(src, cache);
+	else
+		m_shaders[index].BeginFromSource(src, vertSrc, cache);
+}
+
+void ShaderStorage::Finish()
+{
+	for (Shader& shader : m_shaders)
+		shader.Poll(true);
 }
 
-void ShaderStorage::Bind(BaseShader type) const
+BaseShader ShaderStorage::Bind(BaseShader type) const
 {
 	RENDERER_ASSERT(type < BaseShader_COUNT && type >= 0, "Invalid shader supplied");
+	if (!m_shaders[type].IsOk())
+		type = Sh_WhiteFill;
 	RENDERER_ASSERT(m_shaders[type].IsOk(), "This shader wasn't created successfully!");
 	m_shaders[type].Bind();
+	return type;
 }
 
 void ShaderStorage::Unbind() const
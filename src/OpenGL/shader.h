@@ -1,8 +1,9 @@
 #pragma once
 
 #include "../Utils/logger.h"
-
-typedef uint32_t RID;
+#include "../Utils/fileWatcher.h"
+#include "programCache.h"
+#include "shaderPreprocessor.h"
 
 class Shader
 {
@@ -12,26 +13,54 @@ public:
 
 	inline bool IsOk() const { return m_id != 0; }
 
-	void Init(const std::string& fragFile);
-	void Init(const std::string& fragFile, const std::string& vertFile);
+	/** From sources in memory, without a vertex source the fullscreen quad one is used. Goes through the cache when one is given */
+	void InitFromSource(std::string_view fragSrc, std::string_view vertSrc = {}, ProgramCache* cache = nullptr);
+	/** Like InitFromSource but doesn't wait for the driver, the current program stays in use until Poll finds the new one linked */
+	void BeginFromSource(std::string_view fragSrc, std::string_view vertSrc = {}, ProgramCache* cache = nullptr);
+	/** A compute program, built like the above. Needs GL 4.3 */
+	void InitComputeFromSource(std::string_view compSrc, ProgramCache* cache = nullptr);
+	void BeginComputeFromSource(std::string_view compSrc, ProgramCache* cache = nullptr);
+	/** Finishes a started build if the driver is done with it, or always when waiting. True if nothing is left pending */
+	bool Poll(bool wait = false);
+	inline bool IsPending() const { return m_pending.program != 0; }
+
+	/** Lets the driver compile on its own threads, if it supports KHR_parallel_shader_compile. Needs a current context */
+	static bool EnableParallelCompile();
 
 	void Bind() const;
 	void Unbind() const;
 
 	// Setting uniforms
 	void SetUniform1i(const std::string& name, int32_t v);
+	void SetUniform1ui(const std::string& name, uint32_t v);
 	void SetUniform1f(const std::string& name, float v);
 	void SetUniform2f(const std::string& name, float v0, float v1);
 	void SetUniform4f(const std::string& name, float v0, float v1, float v2, float v3);
+	void SetUniform4fv(const std::string& name, uint32_t count, const float* v);
 	void SetUniformMat4f(const std::string& name, const float* mat);
 
 private:
+	// Submitted to the driver but not checked yet
+	struct PendingProgram
+	{
+		RID program = 0, vs = 0, fs = 0, cs = 0;	// cs is only set for compute programs, which have no vs and fs
+		std::string fragSrc, vertSrc;	// For the cache key, the compute source is in fragSrc
+		ProgramCache* cache = nullptr;
+	};
+
 	RID m_id;
 	std::unordered_map<std::string, int32_t> m_UniformLocationCache;
+	PendingProgram m_pending;
 private:
-	bool LoadFileToString(std::string& outBuf, const std::string& fName);
-	RID CreateShader(const std::string& fragSrc, const std::string& vertSrc);
-	RID CompileShader(uint32_t type, const std::string& src);
+	/** Replaces the program, the old one is deleted and its uniform locations forgotten */
+	void SetProgram(RID program);
+	PendingProgram SubmitProgram(std::string_view fragSrc, std::string_view vertSrc, bool retrievable);
+	PendingProgram SubmitCompute(std::string_view compSrc, bool retrievable);
+	void DropPending();
+	/** Checks the compile and link results, the program on success and 0 after logging the errors */
+	RID FinishProgram(PendingProgram& pending);
+	RID CompileShader(uint32_t type, std::string_view src);
+	bool CheckCompile(RID id, uint32_t type);
 
 	uint32_t GetUniformLocation(const std::string& name);
 };
@@ -41,30 +70,96 @@ enum BaseShader
 	Sh_WhiteFill = 0,
 	Sh_ColorFill,
 	Sh_BlackHole,
+	Sh_BlackHoleDisc,	// Discards outside the circle, for Renderer::DrawDiscSh
 	Sh_Background,
+	Sh_BackgroundTex,	// Sh_Background with its noise read from a NoiseTexture
+	Sh_BackgroundLowRes,	// The two above without the highlight, for drawing at a fraction of the resolution
+	Sh_BackgroundTexLowRes,
+	Sh_BackgroundUpscale,	// Upsamples a low resolution background and adds the highlight
+	Sh_ParticleSimulate,	// Compute passes of ParticleSystem
+	Sh_ParticleEmit,
+	Sh_ParticleFinish,
+	Sh_Particle,			// Draws the particles straight from their buffer
 	BaseShader_COUNT
 };
 
+/** A base shader is a permutation of files in res/shaders, the defines are given as in ShaderPreprocessor::Process */
+struct BaseShaderDesc
+{
+	const char* name;
+	const char* file;		// Fragment shader, or the compute shader of a compute program, which has an empty vertFile
+	const char* vertFile;
+	const char* defines;
+	uint32_t glVersion = 330;	// Needed from the context, shaders above it aren't built
+};
+
+/** Where ShaderStorage gets its programs from */
+struct ShaderConfig
+{
+	std::string overrideDir;	// Read before the sources compiled into the executable when set, so they can be edited without a rebuild. Watched for changes
+	std::string cacheDir;		// Program binaries, the platform's cache directory if empty
+	bool useCache = true;
+};
+
 class ShaderStorage
 {
 public:
 	ShaderStorage();
 	~ShaderStorage() = default;
 
-	void Init();
-
-	void Bind(BaseShader type) const;
+	void Init(const ShaderConfig& config);
+	/**
+	 * Builds every shader again, edited override files are picked up and unchanged ones come from the cache.
+	 * Only Sh_WhiteFill is waited for, the rest compile in the background and are swapped in by Poll.
+	 */
+	void Reload();
+	/**
+	 * Swaps in the programs the driver has finished, once per frame. Without parallel compiles at most one is finished per call.
+	 * Also starts rebuilding the shaders whose files changed in the override directory.
+	 */
+	void Poll();
+	/** Waits for every pending program */
+	void Finish();
+	inline bool IsReady(BaseShader type) const { return m_shaders[type].IsOk(); }
+	/** Of the context, as in #version */
+	inline uint32_t GetGLVersion() const { return m_glVersion; }
+
+	/** Source of a shader file from the override directory if it's there, otherwise the embedded one */
+	static bool GetSource(const std::string& fName, const std::string& overrideDir, std::string& outSrc);
+	static inline const BaseShaderDesc& GetDesc(BaseShader type) { return s_baseShaders[type]; }
+
+	/** Binds Sh_WhiteFill instead of a shader that isn't ready yet, returns the one bound */
+	BaseShader Bind(BaseShader type) const;
 	void Unbind() const;
 
 	inline Shader& GetShader(BaseShader type) { RENDERER_ASSERT(type < BaseShader_COUNT && type >= 0, "Invalid shader supplied"); return m_shaders[type]; }
 
 private:
 	std::vector<Shader> m_shaders;
-
-	static constexpr std::array<std::pair<const char*, const char*>, BaseShader_COUNT> s_baseShaderPaths = {
-		std::make_pair("C:/Omat/Koodailu/Pong/src/res/shaders/whiteFill.frag", ""),
-		{"C:/Omat/Koodailu/Pong/src/res/shaders/colorFill.frag", ""},
-		{"C:/Omat/Koodailu/Pong/src/res/shaders/blackHole.frag", ""},
-		{"C:/Omat/Koodailu/Pong/src/res/shaders/background.frag", ""}
-	};
+	ShaderConfig m_config;
+	ProgramCache m_cache;
+	bool m_parallelCompile;
+	std::chrono::steady_clock::time_point m_reloadStart;
+	FileWatcher m_watcher;
+	ShaderPreprocessor m_preprocessor;
+	std::vector<std::vector<std::string>> m_deps;	// Files each shader was built from
+	uint32_t m_glVersion;
+private:
+	void Rebuild(size_t index);
+
+	static constexpr std::array<BaseShaderDesc, BaseShader_COUNT> s_baseShaders = {{
+		{ "whiteFill", "colorFill.frag", "quad.vert", "FIXED_COLOR=vec4(1.0)" },
+		{ "colorFill", "colorFill.frag", "quad.vert", "" },
+		{ "blackHole", "blackHole.frag", "quad.vert", "" },
+		{ "blackHoleDisc", "blackHole.frag", "quad.vert", "DISCARD_OUTSIDE" },
+		{ "background", "background.frag", "quad.vert", "" },
+		{ "backgroundTex", "background.frag", "quad.vert", "NOISE_TEXTURE" },
+		{ "backgroundLowRes", "background.frag", "quad.vert", "NO_HIGHLIGHT" },
+		{ "backgroundTexLowRes", "background.frag", "quad.vert", "NOISE_TEXTURE;NO_HIGHLIGHT" },
+		{ "backgroundUpscale", "backgroundUpscale.frag", "quad.vert", "" },
+		{ "particleSimulate", "particleSimulate.comp", "", "", 430 },
+		{ "particleEmit", "particleEmit.comp", "", "", 430 },
+		{ "particleFinish", "particleFinish.comp", "", "", 430 },
+		{ "particle", "particle.frag", "particle.vert", "", 430 }
+	}};
 };
\ No newline at end of file
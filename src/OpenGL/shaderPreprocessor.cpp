@@ -0,0 +1,175 @@
+#include "shaderPreprocessor.h"
+
+#include "../Utils/logger.h"
+#include "../Utils/hash.h"
+
+static std::string_view TrimLeft(std::string_view s)
+{
+	const size_t start = s.find_first_not_of(" \t");
+	return start == std::string_view::npos ? std::string_view() : s.substr(start);
+}
+
+static bool StartsWithDirective(std::string_view line, std::string_view directive)
+{
+	if (!line.starts_with('#'))
+		return false;
+	line = TrimLeft(line.substr(1));
+	return line.starts_with(directive) && (line.size() == directive.size() || line[directive.size()] == ' ' || line[directive.size()] == '\t' || line[directive.size()] == '"' || line[directive.size()] == '<');
+}
+
+static void AppendDefines(std::string& out, std::string_view defines)
+{
+	while (!defines.empty()) {
+		const size_t end = std::min(defines.find(';'), defines.size());
+		std::string_view def = TrimLeft(defines.substr(0, end));
+		defines.remove_prefix(std::min(end + 1, defines.size()));
+		if (def.empty())
+			continue;
+		const size_t eq = def.find('=');
+		if (eq == std::string_view::npos)
+			out += std::format("#define {}\n", def);
+		else
+			out += std::format("#define {} {}\n", def.substr(0, eq), def.substr(eq + 1));
+	}
+}
+
+ShaderPreprocessor::ShaderPreprocessor(Loader loader)
+	: m_loader(std::move(loader)),
+	m_files(),
+	m_outputs(),
+	m_hits(0), m_misses(0)
+{
+}
+
+bool ShaderPreprocessor::Process(const std::string& name, std::string_view defines, std::string& out, std::vector<std::string>* deps)
+{
+	const uint64_t key = Hash::Fnv1a(defines, Hash::Fnv1a(std::string_view("\0", 1), Hash::Fnv1a(name)));
+	auto it = m_outputs.find(key);
+	if (it != m_outputs.end()) {
+		bool unchanged = true;
+		for (const auto& [depName, hash] : it->second.deps) {
+			const File* file = this->GetFile(depName);
+			unchanged = unchanged && file && file->hash == hash;
+		}
+		if (unchanged) {
+			m_hits++;
+			out = it->second.text;
+			if (deps) {
+				for (const auto& dep : it->second.deps)
+					deps->push_back(dep.first);
+			}
+			return true;
+		}
+	}
+	m_misses++;
+
+	Expansion exp;
+	this->Expand(name, defines, 0, exp);
+	if (!exp.ok)
+		return false;
+	exp.text += "// Source strings:";
+	for (size_t i = 0; i < exp.files.size(); i++)
+		exp.text += std::format(" {} {}", i, exp.files[i]);
+	exp.text += "\n";
+
+	Output output;
+	output.text = std::move(exp.text);
+	for (const std::string& fName : exp.files) {
+		output.deps.emplace_back(fName, m_files.at(fName).hash);
+		if (deps)
+			deps->push_back(fName);
+	}
+	out = output.text;
+	m_outputs[key] = std::move(output);
+	return true;
+}
+
+void ShaderPreprocessor::SetFile(const std::string& name, std::string contents)
+{
+	const uint64_t hash = Hash::Fnv1a(contents);
+	m_files[name] = { std::move(contents), hash };
+}
+
+void ShaderPreprocessor::ForgetFiles()
+{
+	m_files.clear();
+}
+
+const ShaderPreprocessor::File* ShaderPreprocessor::GetFile(const std::string& name)
+{
+	auto it = m_files.find(name);
+	if (it != m_files.end())
+		return &it->second;
+	std::string text;
+	if (!m_loader(name, text))
+		return nullptr;
+	const uint64_t hash = Hash::Fnv1a(text);
+	return &m_files.emplace(name, File{ std::move(text), hash }).first->second;
+}
+
+void ShaderPreprocessor::Expand(const std::string& name, std::string_view defines, uint32_t depth, Expansion& exp)
+{
+	const File* file = this->GetFile(name);
+	if (!file) {
+		RENDERER_ERROR(std::format("Shader file {} not found", name));
+		exp.ok = false;
+		return;
+	}
+	const size_t index = exp.files.size();
+	exp.files.push_back(name);
+
+	std::string_view text = file->text;
+	// Defines go right after #version, or first if there is none
+	if (depth == 0 && text.find("#version") == std::string_view::npos) {
+		AppendDefines(exp.text, defines);
+		exp.text += std::format("#line 1 {}\n", index);
+	}
+
+	uint32_t lineNo = 0;
+	while (!text.empty() && exp.ok) {
+		const size_t end = std::min(text.find('\n'), text.size());
+		std::string_view line = text.substr(0, end);
+		text.remove_prefix(std::min(end + 1, text.size()));
+		lineNo++;
+		if (line.ends_with('\r'))
+			line.remove_suffix(1);
+		const std::string_view trimmed = TrimLeft(line);
+
+		if (StartsWithDirective(trimmed, "version")) {
+			if (depth > 0) {
+				RENDERER_ERROR(std::format("{}:{}: #version in an included file", name, lineNo));
+				exp.ok = false;
+				return;
+			}
+			exp.text += line;
+			exp.text += '\n';
+			AppendDefines(exp.text, defines);
+			exp.text += std::format("#line {} {}\n", lineNo + 1, index);
+		} else if (StartsWithDirective(trimmed, "include")) {
+			const size_t open = trimmed.find_first_of("\"<");
+			const size_t close = open == std::string_view::npos ? open : trimmed.find(trimmed[open] == '"' ? '"' : '>', open + 1);
+			if (close == std::string_view::npos) {
+				RENDERER_ERROR(std::format("{}:{}: malformed #include", name, lineNo));
+				exp.ok = false;
+				return;
+			}
+			const std::string incName(trimmed.substr(open + 1, close - open - 1));
+			if (std::find(exp.files.begin(), exp.files.end(), incName) != exp.files.end()) {
+				// Already in, the line is kept empty so the numbering doesn't move
+				exp.text += '\n';
+				continue;
+			}
+			if (depth + 1 >= s_maxDepth) {
+				RENDERER_ERROR(std::format("{}:{}: includes nested too deep", name, lineNo));
+				exp.ok = false;
+				return;
+			}
+			exp.text += std::format("#line 1 {}\n", exp.files.size());
+			this->Expand(incName, {}, depth + 1, exp);
+			exp.text += std::format("#line {} {}\n", lineNo + 1, index);
+		} else {
+			exp.text += line;
+			exp.text += '\n';
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Expands #include "file" lines in GLSL and injects #defines right after #version, so shared code lives in one file and
+ * permutations of a shader are specialized at compile time. Every file is included once, later includes of it are skipped.
+ * #line directives keep compile errors pointing at the right file: source string 0 is the shader itself and the rest are
+ * numbered in include order, the numbering is listed in a comment at the end of the output.
+ * Outputs are cached by the content hashes of every file they were built from, so rebuilding unchanged shaders is a lookup.
+ */
+class ShaderPreprocessor
+{
+public:
+	/** Reads a file the preprocessor doesn't have yet, false if there is no such file */
+	using Loader = std::function<bool(const std::string& name, std::string& out)>;
+
+	explicit ShaderPreprocessor(Loader loader);
+	~ShaderPreprocessor() = default;
+
+	/**
+	 * Defines are separated by ';' with an optional value after '=', "FIXED_COLOR=vec4(1.0);FAST".
+	 * The names of every file used are added to deps when it's given.
+	 */
+	bool Process(const std::string& name, std::string_view defines, std::string& out, std::vector<std::string>* deps = nullptr);
+
+	/** New contents for a file, the outputs using it are built again */
+	void SetFile(const std::string& name, std::string contents);
+	/** Forgets the file contents so they are loaded again, outputs are kept and reused if the files didn't change */
+	void ForgetFiles();
+
+	inline uint32_t GetHits() const { return m_hits; }
+	inline uint32_t GetMisses() const { return m_misses; }
+
+private:
+	struct File
+	{
+		std::string text;
+		uint64_t hash;
+	};
+	struct Output
+	{
+		std::string text;
+		std::vector<std::pair<std::string, uint64_t>> deps;	// Name and content hash of every file used
+	};
+	struct Expansion
+	{
+		std::string text;
+		std::vector<std::string> files;		// In source string order
+		bool ok = true;
+	};
+
+	Loader m_loader;
+	std::unordered_map<std::string, File> m_files;
+	std::unordered_map<uint64_t, Output> m_outputs;	// By name and defines
+	uint32_t m_hits, m_misses;
+
+	static constexpr uint32_t s_maxDepth = 16;
+private:
+	const File* GetFile(const std::string& name);
+	void Expand(const std::string& name, std::string_view defines, uint32_t depth, Expansion& exp);
+};
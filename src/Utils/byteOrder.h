@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** Little endian integers in byte buffers, for the file formats and packets, so they read the same on every platform */
+namespace ByteOrder {
+	/** Appends the lowest bytes of v, least significant first */
+	inline void PutLE(std::vector<uint8_t>& buf, uint64_t v, size_t bytes)
+	{
+		for (size_t i = 0; i < bytes; i++)
+			buf.push_back(static_cast<uint8_t>(v >> (8 * i)));
+	}
+
+	/** The bytes at data, least significant first. The caller checks that they are there */
+	inline uint64_t GetLE(const uint8_t* data, size_t bytes)
+	{
+		uint64_t v = 0;
+		for (size_t i = 0; i < bytes; i++)
+			v |= static_cast<uint64_t>(data[i]) << (8 * i);
+		return v;
+	}
+}
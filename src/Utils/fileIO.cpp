@@ -0,0 +1,66 @@
+#include "fileIO.h"
+#include "logger.h"
+
+#include <filesystem>
+#include <thread>
+
+template<typename Buffer>
+static bool ReadWhole(const std::string& fName, Buffer& out, bool logMissing)
+{
+	out.clear();
+	std::ifstream file(fName, std::ios::binary | std::ios::ate);
+	if (!file) {
+		if (logMissing)
+			GAME_ERROR(std::format("Could not open file {}", fName));
+		return false;
+	}
+	const std::streamsize size = file.tellg();
+	if (size < 0) {
+		GAME_ERROR(std::format("Could not get the size of {}", fName));
+		return false;
+	}
+	out.resize(static_cast<size_t>(size));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(out.data()), size);
+	if (file.gcount() != size) {
+		GAME_ERROR(std::format("Could only read {} of {} bytes from {}", file.gcount(), size, fName));
+		out.clear();
+		return false;
+	}
+	return true;
+}
+
+bool FileIO::ReadFile(const std::string& fName, std::string& out, bool logMissing)
+{
+	return ReadWhole(fName, out, logMissing);
+}
+
+bool FileIO::ReadFile(const std::string& fName, std::vector<uint8_t>& out, bool logMissing)
+{
+	return ReadWhole(fName, out, logMissing);
+}
+
+bool FileIO::WriteFile(const std::string& fName, const void* data, size_t size)
+{
+	// Unique per thread, two writers of the same file each rename their own
+	const std::string tmpName = std::format("{}.{}.tmp", fName, std::hash<std::thread::id>()(std::this_thread::get_id()));
+	{
+		std::ofstream file(tmpName, std::ios::binary | std::ios::trunc);
+		file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		if (!file) {
+			GAME_ERROR(std::format("Could not write {}", fName));
+			file.close();
+			std::error_code err;
+			std::filesystem::remove(tmpName, err);
+			return false;
+		}
+	}
+	std::error_code err;
+	std::filesystem::rename(tmpName, fName, err);
+	if (err) {
+		GAME_ERROR(std::format("Could not write {}: {}", fName, err.message()));
+		std::filesystem::remove(tmpName, err);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Whole file reads and writes for every asset, so loading scales with the file's size and not its line count.
+ * Reads size the buffer from the file and fill it with one read. Files only read in place are better mapped with MappedFile.
+ */
+namespace FileIO {
+	/** Missing files are an error unless logMissing is off, for lookups that have something to fall back to */
+	bool ReadFile(const std::string& fName, std::string& out, bool logMissing = true);
+	bool ReadFile(const std::string& fName, std::vector<uint8_t>& out, bool logMissing = true);
+
+	/** Written next to the file and renamed over it, so a crash or a concurrent reader never sees half of it */
+	bool WriteFile(const std::string& fName, const void* data, size_t size);
+}
@@ -0,0 +1,160 @@
+#include "fileWatcher.h"
+#include "logger.h"
+#include "fileIO.h"
+
+#include <filesystem>
+#include <map>
+#include <set>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher()
+	: m_dir(),
+	m_thread(),
+	m_stop(false),
+	m_mutex(),
+	m_changes()
+#ifdef __linux__
+	, m_inotify(-1)
+#endif
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+	this->Stop();
+}
+
+bool FileWatcher::Start(const std::string& dir)
+{
+	this->Stop();
+	if (!std::filesystem::is_directory(dir)) {
+		GAME_ERROR(std::format("Can't watch {}, it's not a directory", dir));
+		return false;
+	}
+	m_dir = dir;
+
+#ifdef __linux__
+	m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	// Saving in place closes a written file, saving through a temporary file moves it in
+	if (m_inotify < 0 || inotify_add_watch(m_inotify, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		GAME_ERROR(std::format("Could not watch {}: {}", dir, strerror(errno)));
+		if (m_inotify >= 0)
+			close(m_inotify);
+		m_inotify = -1;
+		return false;
+	}
+#endif
+	m_stop = false;
+	m_thread = std::thread(&FileWatcher::Run, this);
+	GAME_INFO(std::format("Watching {} for changes", dir));
+	return true;
+}
+
+void FileWatcher::Stop()
+{
+	if (!m_thread.joinable())
+		return;
+	m_stop = true;
+	m_thread.join();
+#ifdef __linux__
+	close(m_inotify);
+	m_inotify = -1;
+#endif
+}
+
+std::vector<FileWatcher::Change> FileWatcher::TakeChanges()
+{
+	std::vector<Change> changes;
+	std::lock_guard lock(m_mutex);
+	changes.swap(m_changes);
+	return changes;
+}
+
+#ifdef __linux__
+void FileWatcher::Run()
+{
+	using Clock = std::chrono::steady_clock;
+	std::map<std::string, Clock::time_point> dirty;	// Name, last event
+	alignas(inotify_event) char buf[4096];
+
+	while (!m_stop) {
+		pollfd pfd = { m_inotify, POLLIN, 0 };
+		const int timeout = dirty.empty() ? s_pollMs : s_quietMs;
+		if (poll(&pfd, 1, timeout) > 0) {
+			ssize_t len;
+			while ((len = read(m_inotify, buf, sizeof(buf))) > 0) {
+				for (char* at = buf; at < buf + len;) {
+					const inotify_event* ev = reinterpret_cast<const inotify_event*>(at);
+					if (ev->len > 0 && !(ev->mask & IN_ISDIR))
+						dirty[ev->name] = Clock::now();
+					at += sizeof(inotify_event) + ev->len;
+				}
+			}
+		}
+
+		const Clock::time_point now = Clock::now();
+		for (auto it = dirty.begin(); it != dirty.end();) {
+			if (now - it->second >= std::chrono::milliseconds(s_quietMs)) {
+				this->Read(it->first);
+				it = dirty.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+}
+#else
+void FileWatcher::Run()
+{
+	namespace fs = std::filesystem;
+	std::map<std::string, fs::file_time_type> times;
+	std::set<std::string> dirty;
+	bool first = true;
+
+	while (!m_stop) {
+		// A file that changed since the previous round is read when it didn't change again
+		std::set<std::string> changed;
+		std::error_code err;
+		for (const fs::directory_entry& entry : fs::directory_iterator(m_dir, err)) {
+			if (!entry.is_regular_file(err))
+				continue;
+			const std::string name = entry.path().filename().string();
+			const fs::file_time_type time = entry.last_write_time(err);
+			auto [it, added] = times.try_emplace(name, time);
+			if (!first && (added || it->second != time))
+				changed.insert(name);
+			it->second = time;
+		}
+		first = false;
+
+		for (const std::string& name : dirty) {
+			if (!changed.contains(name))
+				this->Read(name);
+		}
+		dirty = std::move(changed);
+		std::this_thread::sleep_for(std::chrono::milliseconds(s_pollMs));
+	}
+}
+#endif
+
+void FileWatcher::Read(const std::string& name)
+{
+	// Deleted again before it was read
+	Change change{ name, {} };
+	if (!FileIO::ReadFile(std::format("{}/{}", m_dir, name), change.contents, false))
+		return;
+
+	std::lock_guard lock(m_mutex);
+	for (Change& c : m_changes) {
+		if (c.name == name) {
+			c.contents = std::move(change.contents);
+			return;
+		}
+	}
+	m_changes.push_back(std::move(change));
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Watches the files of one directory on its own thread and reads the changed ones there, so the thread taking the changes never touches the disk.
+ * Uses inotify on Linux and compares modification times a few times a second elsewhere.
+ * Editors often write a file in several steps, a change is only read once the file has been quiet for a moment.
+ */
+class FileWatcher
+{
+public:
+	struct Change
+	{
+		std::string name;		// Relative to the directory
+		std::string contents;
+	};
+
+	FileWatcher();
+	~FileWatcher();
+
+	bool Start(const std::string& dir);
+	void Stop();
+	inline bool IsRunning() const { return m_thread.joinable(); }
+
+	/** Changes read since the previous call, the newest contents once per file */
+	std::vector<Change> TakeChanges();
+
+private:
+	std::string m_dir;
+	std::thread m_thread;
+	std::atomic<bool> m_stop;
+	std::mutex m_mutex;
+	std::vector<Change> m_changes;	// Guarded by m_mutex
+#ifdef __linux__
+	int m_inotify;
+#endif
+
+	static constexpr int s_quietMs = 50;
+	static constexpr int s_pollMs = 250;	// Without inotify, also how often the stop flag is looked at
+private:
+	void Run();
+	void Read(const std::string& name);
+};
@@ -0,0 +1,98 @@
+#include "framePacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+FramePacer::FramePacer(PacingMode mode, float capFps, float refreshHz)
+	: m_mode(mode), m_capPeriod(capFps > 0.f ? 1.0 / capFps : 0.0), m_refreshPeriod(1.0 / std::max(refreshHz, 1.f)),
+	m_frameStart(Clock::now()), m_workEnd(m_frameStart), m_lastPresent(m_frameStart), m_hasPresent(false),
+	m_workEstimate(0.002), m_margin(s_minMargin)
+{
+	if (m_mode == Pace_Capped && m_capPeriod <= 0.0)
+		m_mode = Pace_Uncapped;
+}
+
+const char* FramePacer::GetName(PacingMode mode)
+{
+	switch (mode) {
+	case Pace_VSync:
+		return "vsync";
+	case Pace_Uncapped:
+		return "uncapped";
+	case Pace_Capped:
+		return "capped";
+	case Pace_LateLatch:
+		return "latelatch";
+	default:
+		return "unknown";
+	}
+}
+
+void FramePacer::SleepUntil(Clock::time_point until)
+{
+	// Running mean and deviation of how long a 1 ms sleep really takes, shared by all callers on the thread
+	thread_local double estimate = 0.002, mean = 0.002, m2 = 0.0;
+	thread_local uint64_t count = 1;
+
+	while (true) {
+		const double remaining = std::chrono::duration<double>(until - Clock::now()).count();
+		if (remaining <= estimate)
+			break;
+		const auto start = Clock::now();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		const double took = std::chrono::duration<double>(Clock::now() - start).count();
+
+		// Welford's update, the spin covers the mean plus one deviation
+		count++;
+		const double delta = took - mean;
+		mean += delta / count;
+		m2 += delta * (took - mean);
+		estimate = mean + std::sqrt(m2 / (count - 1));
+	}
+	while (Clock::now() < until)
+		std::this_thread::yield();
+}
+
+void FramePacer::WaitForFrameStart()
+{
+	const auto now = Clock::now();
+	if (m_mode == Pace_Capped) {
+		// Scheduled from the previous start so the rate doesn't drift with the work time
+		auto next = m_frameStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_capPeriod));
+		if (next < now)
+			next = now;
+		SleepUntil(next);
+	} else if (m_mode == Pace_LateLatch && m_hasPresent) {
+		// The refresh after the last present, or a later one if that's already out of reach
+		const double sinceLast = std::chrono::duration<double>(now - m_lastPresent).count();
+		const double lead = m_workEstimate + m_margin;
+		double target = m_refreshPeriod;
+		while (target - lead < sinceLast)
+			target += m_refreshPeriod;
+		SleepUntil(m_lastPresent + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(target - lead)));
+	}
+	m_frameStart = Clock::now();
+}
+
+void FramePacer::EndWork()
+{
+	m_workEnd = Clock::now();
+	const double work = std::chrono::duration<double>(m_workEnd - m_frameStart).count();
+	m_workEstimate = work > m_workEstimate ? work : m_workEstimate * 0.98 + work * 0.02;
+}
+
+void FramePacer::OnPresented()
+{
+	const auto now = Clock::now();
+	if (m_mode == Pace_LateLatch) {
+		// On time the swap only waits out the margin, about a refresh more means the frame missed it
+		const double swapWait = std::chrono::duration<double>(now - m_workEnd).count();
+		if (m_hasPresent && swapWait > m_margin + m_refreshPeriod * 0.5)
+			m_margin = std::min(m_margin * 1.5, s_maxMargin);
+		else
+			m_margin = std::max(m_margin * 0.999, s_minMargin);
+	}
+	m_lastPresent = now;
+	m_hasPresent = true;
+}
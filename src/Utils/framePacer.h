@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+enum PacingMode
+{
+	Pace_VSync = 0,
+	Pace_Uncapped,
+	Pace_Capped,		// Sleeps and spins to a target frame rate without vsync
+	Pace_LateLatch,		// VSync, but starts each frame as late as it can still make the next refresh
+	PacingMode_COUNT
+};
+
+/**
+ * Decides when the render thread starts building a frame.
+ * Late latch predicts the next refresh from the previous present, waits until just before it minus the measured
+ * render cost, and only then takes the newest simulation state. The input to photon delay shrinks by
+ * up to a frame compared to plain vsync, where the frame is built right after the previous swap and then waits.
+ */
+class FramePacer
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	FramePacer(PacingMode mode, float capFps, float refreshHz);
+
+	inline PacingMode GetMode() const { return m_mode; }
+	/** Swap interval the context should use */
+	inline int GetSwapInterval() const { return m_mode == Pace_VSync || m_mode == Pace_LateLatch ? 1 : 0; }
+	/** Late latch needs the swap to have finished when OnPresented is called, so the present time is known */
+	inline bool NeedsPresentWait() const { return m_mode == Pace_LateLatch; }
+
+	/** Blocks until the next frame should be started */
+	void WaitForFrameStart();
+	/** The frame has been built and is about to be swapped */
+	void EndWork();
+	/** The swap has returned */
+	void OnPresented();
+
+	inline float GetWorkEstimate() const { return static_cast<float>(m_workEstimate); }
+
+	static const char* GetName(PacingMode mode);
+	/** Sleeps most of the way and spins the rest, with the sleep overshoot learned as it goes */
+	static void SleepUntil(Clock::time_point until);
+
+private:
+	PacingMode m_mode;
+	double m_capPeriod;			// Seconds
+	double m_refreshPeriod;
+	Clock::time_point m_frameStart, m_workEnd, m_lastPresent;
+	bool m_hasPresent;
+	double m_workEstimate;		// Seconds from frame start to swap, tracks spikes fast and decays slowly
+	double m_margin;			// Extra slack before the refresh, grows when a frame misses it
+
+	static constexpr double s_minMargin = 0.001;
+	static constexpr double s_maxMargin = 0.006;
+};
@@ -0,0 +1,137 @@
+#include "frameStats.h"
+#include "logger.h"
+
+#include <algorithm>
+
+static constexpr float s_binsPerDecade = 8.0f;
+
+FrameStats::FrameStats(size_t window)
+	: m_windowSize(std::max<size_t>(window, 16)), m_channels()
+{
+	for (Channel& c : m_channels) {
+		c.window.reserve(m_windowSize);
+		c.scratch.reserve(m_windowSize);
+	}
+}
+
+const char* FrameStats::GetName(StatChannel ch)
+{
+	switch (ch) {
+	case Stat_Frame:
+		return "frame";
+	case Stat_Render:
+		return "render";
+	case Stat_Sim:
+		return "sim";
+	case Stat_Overlay:
+		return "overlay";
+	default:
+		return "unknown";
+	}
+}
+
+size_t FrameStats::GetBin(float secs)
+{
+	if (secs <= s_histMin)
+		return 0;
+	const float bin = std::log10(secs / s_histMin) * s_binsPerDecade;
+	return std::min(static_cast<size_t>(bin), s_histBins - 1);
+}
+
+float FrameStats::GetBinStart(size_t bin)
+{
+	return s_histMin * std::pow(10.0f, bin / s_binsPerDecade);
+}
+
+void FrameStats::Record(StatChannel ch, float secs)
+{
+	Channel& c = m_channels[ch];
+	std::lock_guard<std::mutex> lock(c.mutex);
+
+	if (c.window.size() < m_windowSize)
+		c.window.push_back(secs);
+	else
+		c.window[c.next] = secs;
+	c.next = (c.next + 1) % m_windowSize;
+	c.total++;
+	c.hist[GetBin(secs)]++;
+
+	// The median moves slowly, a fresh one every 64 samples is plenty
+	if ((c.total & 63) == 1) {
+		c.scratch.assign(c.window.begin(), c.window.end());
+		std::nth_element(c.scratch.begin(), c.scratch.begin() + c.scratch.size() / 2, c.scratch.end());
+		c.median = c.scratch[c.scratch.size() / 2];
+	}
+	if (c.total > 64 && secs > std::max(c.median * s_hitchFactor, s_hitchMin))
+		c.hitches++;
+}
+
+StatSummary FrameStats::Summarize(const Channel& c, std::vector<float>& scratch)
+{
+	StatSummary s;
+	s.hitches = c.hitches;
+	s.count = c.window.size();
+	if (c.window.empty())
+		return s;
+
+	scratch.assign(c.window.begin(), c.window.end());
+	std::sort(scratch.begin(), scratch.end());
+	auto at = [&scratch](float q) { return scratch[std::min(static_cast<size_t>(q * scratch.size()), scratch.size() - 1)]; };
+	s.p50 = at(0.50f);
+	s.p95 = at(0.95f);
+	s.p99 = at(0.99f);
+	s.max = scratch.back();
+	return s;
+}
+
+StatSummary FrameStats::GetSummary(StatChannel ch) const
+{
+	const Channel& c = m_channels[ch];
+	std::vector<float> scratch;
+	std::lock_guard<std::mutex> lock(c.mutex);
+	return Summarize(c, scratch);
+}
+
+void FrameStats::GetRecent(StatChannel ch, size_t count, std::vector<float>& out) const
+{
+	const Channel& c = m_channels[ch];
+	std::lock_guard<std::mutex> lock(c.mutex);
+	count = std::min(count, c.window.size());
+	out.resize(count);
+	// next is always one past the newest sample
+	for (size_t i = 0; i < count; i++)
+		out[i] = c.window[(c.next + c.window.size() - count + i) % c.window.size()];
+}
+
+bool FrameStats::WriteCsv(const std::string& fName) const
+{
+	std::ofstream file(fName);
+	if (!file) {
+		GAME_ERROR(std::format("Could not open file {}", fName));
+		return false;
+	}
+
+	std::vector<float> scratch;
+	file << "channel,samples,window,p50_ms,p95_ms,p99_ms,max_ms,hitches\n";
+	for (int ch = 0; ch < StatChannel_COUNT; ch++) {
+		const Channel& c = m_channels[ch];
+		std::lock_guard<std::mutex> lock(c.mutex);
+		const StatSummary s = Summarize(c, scratch);
+		file << std::format("{},{},{},{:.4f},{:.4f},{:.4f},{:.4f},{}\n", GetName(static_cast<StatChannel>(ch)), c.total, s.count,
+			s.p50 * 1e3f, s.p95 * 1e3f, s.p99 * 1e3f, s.max * 1e3f, s.hitches);
+	}
+
+	file << "\nfrom_ms";
+	for (int ch = 0; ch < StatChannel_COUNT; ch++)
+		file << "," << GetName(static_cast<StatChannel>(ch));
+	file << "\n";
+	for (size_t b = 0; b < s_histBins; b++) {
+		file << std::format("{:.4f}", GetBinStart(b) * 1e3f);
+		for (int ch = 0; ch < StatChannel_COUNT; ch++) {
+			std::lock_guard<std::mutex> lock(m_channels[ch].mutex);
+			file << "," << m_channels[ch].hist[b];
+		}
+		file << "\n";
+	}
+	return true;
+}
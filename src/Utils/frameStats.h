@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum StatChannel
+{
+	Stat_Frame = 0,		// Between frame starts on the render thread
+	Stat_Render,		// Building a frame, up to the swap
+	Stat_Sim,			// One simulation tick
+	Stat_Overlay,		// Building and drawing the debug overlay, so its cost can be told apart
+	StatChannel_COUNT
+};
+
+struct StatSummary
+{
+	uint64_t count = 0;			// Samples in the window
+	float p50 = 0.0f, p95 = 0.0f, p99 = 0.0f, max = 0.0f;	// Seconds
+	uint64_t hitches = 0;		// Over the whole run
+};
+
+/**
+ * Rolling window of timings per channel for percentiles, plus a log scale histogram and hitch count over the whole run.
+ * Each channel can be written from its own thread and read from any.
+ */
+class FrameStats
+{
+public:
+	explicit FrameStats(size_t window = 2048);
+
+	void Record(StatChannel ch, float secs);
+	StatSummary GetSummary(StatChannel ch) const;
+	/** Up to count newest samples, oldest first */
+	void GetRecent(StatChannel ch, size_t count, std::vector<float>& out) const;
+
+	/** Summaries and histograms of every channel */
+	bool WriteCsv(const std::string& fName) const;
+
+	static const char* GetName(StatChannel ch);
+
+	static constexpr size_t s_histBins = 48;		// 8 per decade from 10 us up
+	static constexpr float s_histMin = 1e-5f;
+	static constexpr float s_hitchFactor = 2.0f;	// Over twice the running median
+	static constexpr float s_hitchMin = 0.002f;		// Shorter is never a hitch however fast the median
+
+private:
+	struct Channel
+	{
+		mutable std::mutex mutex;
+		std::vector<float> window;
+		size_t next = 0;
+		uint64_t total = 0;
+		float median = 0.0f;	// Refreshed every so often, for hitch detection
+		uint64_t hitches = 0;
+		std::array<uint64_t, s_histBins> hist{};
+		std::vector<float> scratch;
+	};
+
+	size_t m_windowSize;
+	std::array<Channel, StatChannel_COUNT> m_channels;
+private:
+	static size_t GetBin(float secs);
+	static float GetBinStart(size_t bin);
+	static StatSummary Summarize(const Channel& c, std::vector<float>& scratch);
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace Hash {
+	/** 64 bit FNV-1a, continued from a previous hash when one is given. Fast for short keys and the same on every platform */
+	inline uint64_t Fnv1a(std::string_view data, uint64_t hash = 0xcbf29ce484222325ull)
+	{
+		for (char c : data) {
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+}
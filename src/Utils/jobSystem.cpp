@@ -0,0 +1,135 @@
+#include "jobSystem.h"
+#include "logger.h"
+
+// Index of the queue owned by the current thread in the pool it works for, outside threads share the last one
+static thread_local int32_t s_workerIndex = -1;
+static thread_local const JobSystem* s_workerPool = nullptr;
+
+void WorkQueue::Push(Job job)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_jobs.push_back(std::move(job));
+}
+
+bool WorkQueue::Pop(Job& out)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_jobs.empty())
+		return false;
+	out = std::move(m_jobs.back());
+	m_jobs.pop_back();
+	return true;
+}
+
+bool WorkQueue::Steal(Job& out)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_jobs.empty())
+		return false;
+	out = std::move(m_jobs.front());
+	m_jobs.pop_front();
+	return true;
+}
+
+// *** JobSystem *** //
+
+JobSystem::JobSystem(int32_t workerCount)
+	: m_workers(),
+	m_queues(),
+	m_pending(0),
+	m_quit(false),
+	m_nextQueue(0)
+{
+	if (workerCount < 0)
+		workerCount = std::max(static_cast<int32_t>(std::thread::hardware_concurrency()) - 1, 0);
+
+	m_queues = std::vector<WorkQueue>(workerCount + 1);
+	m_workers.reserve(workerCount);
+	for (int32_t i = 0; i < workerCount; i++)
+		m_workers.emplace_back(&JobSystem::WorkerLoop, this, static_cast<uint32_t>(i));
+
+	GAME_INFO(std::format("Job system started with {} worker threads", workerCount));
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_quit = true;
+	}
+	m_wake.notify_all();
+	for (std::thread& t : m_workers)
+		t.join();
+}
+
+void JobSystem::ParallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& fn)
+{
+	if (end <= begin)
+		return;
+	grain = std::max<size_t>(grain, 1);
+
+	// Not worth the handoff
+	if (end - begin <= grain || m_workers.empty()) {
+		for (size_t first = begin; first < end; first += grain)
+			fn(first, std::min(first + grain, end));
+		return;
+	}
+
+	std::atomic<size_t> remaining((end - begin + grain - 1) / grain);
+	for (size_t first = begin; first < end; first += grain) {
+		size_t last = std::min(first + grain, end);
+		this->Submit([&fn, &remaining, first, last]() {
+			fn(first, last);
+			remaining.fetch_sub(1, std::memory_order_release);
+		});
+	}
+
+	// Help out until our own chunks are finished, possibly running other callers' jobs as well
+	const uint32_t ownQueue = s_workerPool == this ? static_cast<uint32_t>(s_workerIndex) : GetWorkerCount();
+	while (remaining.load(std::memory_order_acquire) > 0) {
+		if (!this->RunOne(ownQueue))
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::Submit(Job job)
+{
+	// Workers push to their own deque, other threads and other pools' workers spread the jobs round robin
+	uint32_t queue = s_workerPool == this ? static_cast<uint32_t>(s_workerIndex) : m_nextQueue.fetch_add(1) % GetWorkerCount();
+	m_queues[queue].Push(std::move(job));
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_pending.fetch_add(1);
+	}
+	m_wake.notify_one();
+}
+
+bool JobSystem::RunOne(uint32_t ownQueue)
+{
+	Job job;
+	bool found = m_queues[ownQueue].Pop(job);
+	const uint32_t queueCount = static_cast<uint32_t>(m_queues.size());
+	for (uint32_t i = 1; !found && i < queueCount; i++)
+		found = m_queues[(ownQueue + i) % queueCount].Steal(job);
+	if (!found)
+		return false;
+
+	m_pending.fetch_sub(1);
+	job();
+	return true;
+}
+
+void JobSystem::WorkerLoop(uint32_t index)
+{
+	s_workerIndex = static_cast<int32_t>(index);
+	s_workerPool = this;
+	while (true) {
+		if (this->RunOne(index))
+			continue;
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_wake.wait(lock, [this]() { return m_quit || m_pending > 0; });
+		if (m_quit)
+			return;
+	}
+}
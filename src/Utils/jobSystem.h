@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+typedef std::function<void()> Job;
+
+/** A per-worker job deque, the owner pops from the back and thieves steal from the front */
+class WorkQueue
+{
+public:
+	void Push(Job job);
+	bool Pop(Job& out);
+	bool Steal(Job& out);
+
+private:
+	std::mutex m_mutex;
+	std::deque<Job> m_jobs;
+};
+
+/**
+ * Fixed pool of worker threads with work-stealing deques.
+ * The thread calling ParallelFor participates in the work, so a pool with zero workers runs everything inline.
+ */
+class JobSystem
+{
+public:
+	/** workerCount < 0 picks hardware_concurrency - 1 */
+	explicit JobSystem(int32_t workerCount = -1);
+	~JobSystem();
+
+	JobSystem(const JobSystem& other) = delete;
+	JobSystem& operator=(const JobSystem& other) = delete;
+
+	inline uint32_t GetWorkerCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+	/**
+	 * Calls fn(first, last) for consecutive chunks of at most grain indices covering [begin, end) and returns once all are done.
+	 * Chunk boundaries only depend on the range and grain, never on the thread count, so per-index results are deterministic.
+	 */
+	void ParallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+private:
+	std::vector<std::thread> m_workers;
+	std::vector<WorkQueue> m_queues;	// One per worker and the last one for outside threads
+	std::atomic<size_t> m_pending;
+	std::atomic<bool> m_quit;
+	std::atomic<uint32_t> m_nextQueue;
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wake;
+private:
+	void WorkerLoop(uint32_t index);
+	void Submit(Job job);
+	bool RunOne(uint32_t ownQueue);
+};
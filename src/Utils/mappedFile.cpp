@@ -0,0 +1,117 @@
+#include "mappedFile.h"
+#include "logger.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+	: m_data(nullptr), m_size(0)
+#ifdef _WIN32
+	, m_file(nullptr), m_mapping(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	this->Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: MappedFile()
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other) {
+		this->Close();
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+#ifdef _WIN32
+		std::swap(m_file, other.m_file);
+		std::swap(m_mapping, other.m_mapping);
+#endif
+	}
+	return *this;
+}
+
+bool MappedFile::Open(const std::string& fName)
+{
+	this->Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		GAME_ERROR(std::format("Could not open file {}", fName));
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		GAME_ERROR(std::format("Could not map empty file {}", fName));
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!data) {
+		GAME_ERROR(std::format("Could not map file {}", fName));
+		if (mapping)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	m_file = file;
+	m_mapping = mapping;
+	m_size = static_cast<size_t>(size.QuadPart);
+#else
+	int fd = open(fName.c_str(), O_RDONLY);
+	if (fd < 0) {
+		GAME_ERROR(std::format("Could not open file {}", fName));
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		GAME_ERROR(std::format("Could not map empty file {}", fName));
+		close(fd);
+		return false;
+	}
+	void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping stays valid after closing the descriptor
+	close(fd);
+	if (data == MAP_FAILED) {
+		GAME_ERROR(std::format("Could not map file {}", fName));
+		return false;
+	}
+	m_size = static_cast<size_t>(st.st_size);
+#endif
+
+	m_data = static_cast<const uint8_t*>(data);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (!m_data)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+	CloseHandle(m_mapping);
+	CloseHandle(m_file);
+	m_mapping = nullptr;
+	m_file = nullptr;
+#else
+	munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/** Read-only memory mapping of a whole file, unmapped when destroyed */
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile& other) = delete;
+	MappedFile& operator=(const MappedFile& other) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	bool Open(const std::string& fName);
+	void Close();
+
+	inline bool IsOpen() const { return m_data != nullptr; }
+	inline const uint8_t* GetData() const { return m_data; }
+	inline size_t GetSize() const { return m_size; }
+
+private:
+	const uint8_t* m_data;
+	size_t m_size;
+#ifdef _WIN32
+	void* m_file;
+	void* m_mapping;
+#endif
+};
@@ -0,0 +1,33 @@
+#include "memoryUsage.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define PSAPI_VERSION 2
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <cstdio>
+#include <unistd.h>
+#endif
+
+size_t GetResidentMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.WorkingSetSize;
+#elif defined(__linux__)
+	// Second field of statm is the resident page count
+	FILE* file = fopen("/proc/self/statm", "r");
+	if (!file)
+		return 0;
+	unsigned long long size = 0, resident = 0;
+	const int read = fscanf(file, "%llu %llu", &size, &resident);
+	fclose(file);
+	return read == 2 ? static_cast<size_t>(resident) * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#else
+	return 0;
+#endif
+}
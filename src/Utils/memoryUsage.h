@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstddef>
+
+/** Resident set size of the process in bytes, 0 where it can't be queried */
+size_t GetResidentMemory();
@@ -0,0 +1,74 @@
+#include "random.h"
+
+static inline uint64_t Rotl(uint64_t x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+uint64_t Rng::SplitMix64(uint64_t& x)
+{
+	uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+Rng::Rng(uint64_t seed)
+	: m_state()
+{
+	// SplitMix64 spreads any seed (even 0) into a valid, well mixed state
+	for (uint64_t& s : m_state)
+		s = SplitMix64(seed);
+}
+
+uint64_t Rng::Next()
+{
+	const uint64_t result = Rotl(m_state[1] * 5, 7) * 9;
+	const uint64_t t = m_state[1] << 17;
+
+	m_state[2] ^= m_state[0];
+	m_state[3] ^= m_state[1];
+	m_state[1] ^= m_state[2];
+	m_state[0] ^= m_state[3];
+	m_state[2] ^= t;
+	m_state[3] = Rotl(m_state[3], 45);
+
+	return result;
+}
+
+float Rng::UniformF(float lo, float hi)
+{
+	// Top 24 bits fill the float mantissa exactly
+	const float unit = static_cast<float>(this->Next() >> 40) * (1.f / 16777216.f);
+	return lo + (hi - lo) * unit;
+}
+
+double Rng::Uniform(double lo, double hi)
+{
+	const double unit = static_cast<double>(this->Next() >> 11) * (1.0 / 9007199254740992.0);
+	return lo + (hi - lo) * unit;
+}
+
+Rng Rng::Split()
+{
+	return Rng(this->Next());
+}
+
+// *** RngService *** //
+
+RngService::RngService(uint64_t rootSeed)
+	: m_rootSeed(rootSeed)
+{
+}
+
+Rng RngService::Stream(uint64_t streamId) const
+{
+	uint64_t x = streamId;
+	return Rng(m_rootSeed ^ Rng::SplitMix64(x));
+}
+
+uint64_t RngService::SeedFromClock()
+{
+	uint64_t x = static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+	return Rng::SplitMix64(x);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/**
+ * Small and fast xoshiro256** generator with 32 bytes of state.
+ * The helpers don't go through std distributions so the sequences are the same on every platform.
+ */
+class Rng
+{
+public:
+	typedef uint64_t result_type;
+
+	explicit Rng(uint64_t seed = 0);
+
+	uint64_t Next();
+	inline uint64_t operator()() { return Next(); }
+	static constexpr uint64_t min() { return 0; }
+	static constexpr uint64_t max() { return UINT64_MAX; }
+
+	/** Uniform in [lo, hi) */
+	float UniformF(float lo, float hi);
+	double Uniform(double lo, double hi);
+
+	/** A new generator seeded from this one, for handing out to a child entity */
+	Rng Split();
+
+	inline const std::array<uint64_t, 4>& GetState() const { return m_state; }
+	inline void SetState(const std::array<uint64_t, 4>& state) { m_state = state; }
+
+	static uint64_t SplitMix64(uint64_t& x);
+
+private:
+	std::array<uint64_t, 4> m_state;
+};
+
+/** Hands out reproducible generators derived from one root seed */
+class RngService
+{
+public:
+	explicit RngService(uint64_t rootSeed);
+
+	inline uint64_t GetRootSeed() const { return m_rootSeed; }
+
+	/** Generator for an entity, a batch or a thread, the same id always gives the same sequence */
+	Rng Stream(uint64_t streamId) const;
+
+	/** Root seed from the clock, log it to be able to reproduce the run */
+	static uint64_t SeedFromClock();
+
+private:
+	uint64_t m_rootSeed;
+};
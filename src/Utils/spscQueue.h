@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Lock-free bounded single producer, single consumer ring buffer.
+ * TryPush fails instead of waiting when the queue is full, TryPop when it is empty.
+ */
+template<typename T, size_t Capacity>
+class SpscQueue
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+public:
+	SpscQueue()
+		: m_head(0), m_tail(0), m_items()
+	{ }
+
+	SpscQueue(const SpscQueue& other) = delete;
+	SpscQueue& operator=(const SpscQueue& other) = delete;
+
+	// * Producer side *
+
+	bool TryPush(const T& item) {
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		if (head - m_tail.load(std::memory_order_acquire) == Capacity)
+			return false;
+		m_items[head & s_mask] = item;
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// * Consumer side *
+
+	bool TryPop(T& out) {
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail == m_head.load(std::memory_order_acquire))
+			return false;
+		out = m_items[tail & s_mask];
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	// On separate cache lines so the two sides don't invalidate each other's
+	alignas(64) std::atomic<size_t> m_head;
+	alignas(64) std::atomic<size_t> m_tail;
+	T m_items[Capacity];
+
+	static constexpr size_t s_mask = Capacity - 1;
+};
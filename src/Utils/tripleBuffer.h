@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+
+/**
+ * Lock-free single producer, single consumer triple buffer.
+ * The writer fills GetBack() and publishes it, the reader picks up the newest published buffer with Acquire().
+ * Neither side ever waits, stale buffers are simply skipped.
+ */
+template<typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer()
+		: m_buffers(), m_back(0), m_middle(1), m_front(2)
+	{ }
+
+	TripleBuffer(const TripleBuffer& other) = delete;
+	TripleBuffer& operator=(const TripleBuffer& other) = delete;
+
+	// * Writer side *
+
+	inline T& GetBack() { return m_buffers[m_back]; }
+
+	/** Hands the back buffer over to the reader, the new back buffer holds old data and should be fully rewritten */
+	void Publish() {
+		uint8_t prev = m_middle.exchange(m_back | s_dirtyBit, std::memory_order_acq_rel);
+		m_back = prev & s_indexMask;
+	}
+
+	// * Reader side *
+
+	/** Returns true if a newer buffer was published since the last call */
+	bool Acquire() {
+		if ((m_middle.load(std::memory_order_relaxed) & s_dirtyBit) == 0)
+			return false;
+		uint8_t prev = m_middle.exchange(m_front, std::memory_order_acq_rel);
+		m_front = prev & s_indexMask;
+		return true;
+	}
+
+	inline const T& GetFront() const { return m_buffers[m_front]; }
+
+private:
+	T m_buffers[3];
+	uint8_t m_back;
+	std::atomic<uint8_t> m_middle;	// Index of the buffer in between, with the dirty bit set when it's unread
+	uint8_t m_front;
+
+	static constexpr uint8_t s_dirtyBit = 0x4;
+	static constexpr uint8_t s_indexMask = 0x3;
+};
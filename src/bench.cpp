@@ -0,0 +1,625 @@
+// Benchmark runner, times fixed scenarios with warmup and repetitions and writes the results as JSON for comparing builds
+#include "simulation.h"
+#include "simState.h"
+#include "OpenGL/renderer.h"
+#include "Utils/jobSystem.h"
+#include "Utils/logger.h"
+#include "Utils/random.h"
+
+#include <glad/glad.h>
+
+#include <filesystem>
+#include <functional>
+#include <stdexcept>
+
+#define ARENAWIDTH 1600
+#define ARENAHEIGHT 900
+
+struct BenchConfig
+{
+	uint32_t warmup = 3;
+	uint32_t reps = 15;
+	float minRepMs = 20.f;		// Operations per repetition are raised until one takes at least this long
+	uint64_t seed = 1;
+	std::string filter;			// Only scenarios with this in their name when set
+	std::string outFile = "bench.json";
+	std::string shaderDir;		// Embedded shaders are used if not set
+	std::vector<uint32_t> ballCounts = { 1, 64, 1024, 16384 };
+	uint32_t quads = 4096;
+	int32_t threads = -1;
+	bool useGL = true;
+};
+
+struct BenchResult
+{
+	std::string name;
+	uint64_t itemsPerOp = 1;
+	uint64_t opsPerRep = 0;
+	std::vector<double> nsPerOp;	// One per repetition
+	double median = 0.0, mean = 0.0, min = 0.0, max = 0.0, stddev = 0.0;
+};
+
+// Results are summed in here so the compiler can't drop the measured work
+static volatile double s_sink = 0.0;
+
+/** Discards everything, for timing the logger without the terminal */
+class NullBuffer : public std::streambuf
+{
+protected:
+	int overflow(int c) override { return c; }
+	std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+class Bench
+{
+public:
+	explicit Bench(const BenchConfig& cfg) : m_cfg(cfg), m_results() {}
+
+	inline bool IsSelected(const std::string& name) const { return m_cfg.filter.empty() || name.find(m_cfg.filter) != std::string::npos; }
+
+	/** run(ops) does ops operations of itemsPerOp items each, setup runs before every repetition outside the timing */
+	void Run(const std::string& name, uint64_t itemsPerOp, const std::function<void(uint64_t)>& run, const std::function<void()>& setup = {})
+	{
+		if (!this->IsSelected(name))
+			return;
+
+		auto timeRep = [&](uint64_t ops) {
+			if (setup)
+				setup();
+			const auto start = std::chrono::steady_clock::now();
+			run(ops);
+			return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		};
+
+		// Grow the repetition until it is long enough for the clock, then scale it to the target from the measured rate.
+		// The very first run pays for cold caches and lazy driver setup, it would throw the estimate off.
+		const double minNs = m_cfg.minRepMs * 1e6;
+		uint64_t ops = 1;
+		timeRep(ops);
+		double ns = timeRep(ops);
+		while (ns < minNs && ops < (1ull << 40)) {
+			const double scale = ns > 0.0 ? std::clamp(1.2 * minNs / ns, 2.0, 100.0) : 100.0;
+			ops = static_cast<uint64_t>(std::ceil(ops * scale));
+			ns = timeRep(ops);
+		}
+
+		for (uint32_t i = 0; i < m_cfg.warmup; i++)
+			timeRep(ops);
+
+		BenchResult r;
+		r.name = name;
+		r.itemsPerOp = itemsPerOp;
+		r.opsPerRep = ops;
+		for (uint32_t i = 0; i < m_cfg.reps; i++)
+			r.nsPerOp.push_back(timeRep(ops) / ops);
+		Summarize(r);
+
+		GAME_INFO(std::format("{:<28} {:>12.1f} ns/op {:>14.0f} items/s  (min {:.1f}, max {:.1f}, stddev {:.1f}, {} ops x {})",
+			name, r.median, itemsPerOp * 1e9 / r.median, r.min, r.max, r.stddev, ops, m_cfg.reps));
+		m_results.push_back(std::move(r));
+	}
+
+	bool WriteJson(const std::string& glRenderer) const
+	{
+		std::ofstream file(m_cfg.outFile);
+		if (!file) {
+			GAME_ERROR(std::format("Could not open file {}", m_cfg.outFile));
+			return false;
+		}
+
+#ifdef _MSC_VER
+		const std::string compiler = std::format("msvc {}", _MSC_VER);
+#else
+		const std::string compiler = __VERSION__;
+#endif
+#ifdef NDEBUG
+		constexpr const char* build = "release";
+#else
+		constexpr const char* build = "debug";
+#endif
+		const auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+		file << "{\n";
+		file << std::format("  \"format\": 1,\n  \"timestamp\": {},\n  \"compiler\": \"{}\",\n  \"build\": \"{}\",\n  \"gl_renderer\": \"{}\",\n",
+			timestamp, Escape(compiler), build, Escape(glRenderer));
+		file << std::format("  \"config\": {{ \"warmup\": {}, \"reps\": {}, \"min_rep_ms\": {}, \"seed\": {} }},\n",
+			m_cfg.warmup, m_cfg.reps, m_cfg.minRepMs, m_cfg.seed);
+		file << "  \"results\": [\n";
+		for (size_t i = 0; i < m_results.size(); i++) {
+			const BenchResult& r = m_results[i];
+			file << std::format("    {{ \"name\": \"{}\", \"items_per_op\": {}, \"ops_per_rep\": {}, \"ns_per_op\": {:.3f}, \"items_per_sec\": {:.1f}, "
+				"\"mean\": {:.3f}, \"min\": {:.3f}, \"max\": {:.3f}, \"stddev\": {:.3f}, \"reps\": [",
+				Escape(r.name), r.itemsPerOp, r.opsPerRep, r.median, r.itemsPerOp * 1e9 / r.median, r.mean, r.min, r.max, r.stddev);
+			for (size_t j = 0; j < r.nsPerOp.size(); j++)
+				file << std::format("{}{:.3f}", j ? ", " : "", r.nsPerOp[j]);
+			file << (i + 1 < m_results.size() ? "] },\n" : "] }\n");
+		}
+		file << "  ]\n}\n";
+		return true;
+	}
+
+private:
+	const BenchConfig& m_cfg;
+	std::vector<BenchResult> m_results;
+private:
+	static void Summarize(BenchResult& r)
+	{
+		std::vector<double> sorted = r.nsPerOp;
+		std::sort(sorted.begin(), sorted.end());
+		const size_t n = sorted.size();
+		r.median = n % 2 ? sorted[n / 2] : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+		r.min = sorted.front();
+		r.max = sorted.back();
+		double sum = 0.0, sqSum = 0.0;
+		for (double v : sorted)
+			sum += v;
+		r.mean = sum / n;
+		for (double v : sorted)
+			sqSum += (v - r.mean) * (v - r.mean);
+		r.stddev = n > 1 ? std::sqrt(sqSum / (n - 1)) : 0.0;
+	}
+
+	static std::string Escape(const std::string& str)
+	{
+		std::string out;
+		for (char c : str) {
+			if (c == '"' || c == '\\')
+				out += '\\';
+			if (static_cast<unsigned char>(c) >= 0x20)
+				out += c;
+		}
+		return out;
+	}
+};
+
+static void BenchMatrix(Bench& bench, Rng& rng)
+{
+	// Inputs from a table so that nothing folds into constants
+	constexpr size_t tableSize = 256;
+	std::vector<Mat4> mats;
+	std::vector<Mat2> mat2s;
+	std::vector<Vec2> vecs;
+	for (size_t i = 0; i < tableSize; i++) {
+		std::array<float, 16> m;
+		for (float& v : m)
+			v = rng.UniformF(-1.f, 1.f);
+		mats.emplace_back(m);
+		mat2s.push_back(Mat2({ m[0], m[1], m[2], m[3] }));
+		vecs.push_back(Vec2({ m[4] + 2.f, m[5] }));
+	}
+
+	bench.Run("matrix/mat4_mul", 1, [&](uint64_t ops) {
+		float acc = 0.0f;
+		for (uint64_t i = 0; i < ops; i++)
+			acc += (mats[i % tableSize] * mats[(i + 1) % tableSize])[5];
+		s_sink = s_sink + acc;
+	});
+	bench.Run("matrix/mat2_vec2", 1, [&](uint64_t ops) {
+		float acc = 0.0f;
+		for (uint64_t i = 0; i < ops; i++)
+			acc += (mat2s[i % tableSize] * vecs[i % tableSize])[1];
+		s_sink = s_sink + acc;
+	});
+	bench.Run("matrix/vec2_add_scale", 1, [&](uint64_t ops) {
+		Vec2 acc({ 0.0f, 0.0f });
+		for (uint64_t i = 0; i < ops; i++)
+			acc = acc + vecs[i % tableSize] * 0.5f;
+		s_sink = s_sink + acc[0];
+	});
+	bench.Run("matrix/vec2_normalized", 1, [&](uint64_t ops) {
+		float acc = 0.0f;
+		for (uint64_t i = 0; i < ops; i++)
+			acc += vecs[i % tableSize].normalized()[0];
+		s_sink = s_sink + acc;
+	});
+	bench.Run("matrix/mat4_invert", 1, [&](uint64_t ops) {
+		float acc = 0.0f;
+		for (uint64_t i = 0; i < ops; i++)
+			acc += mats[i % tableSize].Invert()[0];
+		s_sink = s_sink + acc;
+	});
+}
+
+/** A snapshot of a fresh match with count dots spread over the arena in random directions */
+static std::vector<uint64_t> MakeBallState(uint32_t count, Rng& rng)
+{
+	Simulation base(static_cast<float>(ARENAWIDTH), static_cast<float>(ARENAHEIGHT), rng.Next());
+	std::vector<uint64_t> baseState;
+	base.SaveState(baseState);
+	const SimState::Header* baseHeader = reinterpret_cast<const SimState::Header*>(baseState.data());
+
+	std::vector<uint64_t> state((SimState::GetSize(count, baseHeader->wellCount) + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+	SimState::Header* header = reinterpret_cast<SimState::Header*>(state.data());
+	*header = *baseHeader;
+	header->dotCount = count;
+
+	SimState::Dot* dots = reinterpret_cast<SimState::Dot*>(header + 1);
+	for (uint32_t i = 0; i < count; i++) {
+		const float dir = rng.UniformF(0.f, 6.2831853f);
+		dots[i] = { { rng.UniformF(50.f, ARENAWIDTH - 50.f), rng.UniformF(20.f, ARENAHEIGHT - 20.f) },
+			{ Projectile::s_speed * std::cos(dir), Projectile::s_speed * std::sin(dir) } };
+	}
+	memcpy(dots + count, SimState::GetWells(baseHeader), baseHeader->wellCount * sizeof(SimState::Well));
+	return state;
+}
+
+static void BenchPhysics(Bench& bench, const BenchConfig& cfg, JobSystem& jobs, Rng& rng)
+{
+	constexpr float dt = 1.f / 240.f;
+
+	for (uint32_t count : cfg.ballCounts) {
+		const std::vector<uint64_t> state = MakeBallState(count, rng);
+		Simulation sim(static_cast<float>(ARENAWIDTH), static_cast<float>(ARENAHEIGHT), 0);
+		// Every repetition starts from the same state, escaped dots would otherwise skip the collision work
+		auto reset = [&]() { sim.LoadState(state.data(), state.size() * sizeof(uint64_t)); };
+		const TickInput input{ Ctrl_Up, Ctrl_Down };
+
+		bench.Run(std::format("physics/step_{}", count), count, [&](uint64_t ops) {
+			uint32_t hits = 0;
+			for (uint64_t i = 0; i < ops; i++)
+				hits += sim.Step(input, dt).barHits;
+			s_sink = s_sink + hits;
+		}, reset);
+		if (count >= 1024) {
+			bench.Run(std::format("physics/step_{}_jobs", count), count, [&](uint64_t ops) {
+				uint32_t hits = 0;
+				for (uint64_t i = 0; i < ops; i++)
+					hits += sim.Step(input, dt, &jobs).barHits;
+				s_sink = s_sink + hits;
+			}, reset);
+		}
+	}
+}
+
+static void BenchCollisions(Bench& bench, const BenchConfig& cfg, Rng& rng)
+{
+	const Bar left(ARENAHEIGHT, true), right(ARENAHEIGHT, false);
+	const float leftX = left.GetCollisionX(ARENAWIDTH), rightX = right.GetCollisionX(ARENAWIDTH);
+
+	for (uint32_t count : cfg.ballCounts) {
+		// Dots at the bars, moving into them, so that most checks take the bounce path
+		std::vector<Projectile> initial;
+		for (uint32_t i = 0; i < count; i++) {
+			const bool atLeft = i % 2 == 0;
+			const Vec2 pos({ atLeft ? leftX + rng.UniformF(-5.f, 5.f) : rightX + rng.UniformF(-5.f, 5.f),
+				ARENAHEIGHT * 0.5f + rng.UniformF(-1.5f, 1.5f) * Bar::s_height });
+			const Vec2 vel({ atLeft ? -Projectile::s_speed : Projectile::s_speed, rng.UniformF(-0.5f, 0.5f) });
+			initial.emplace_back(DotState{ pos, vel });
+		}
+		std::vector<Projectile> dots;
+
+		bench.Run(std::format("collision/bars_{}", count), count, [&](uint64_t ops) {
+			uint32_t hits = 0;
+			for (uint64_t i = 0; i < ops; i++) {
+				for (Projectile& d : dots) {
+					d.CheckYCollision(ARENAHEIGHT);
+					hits += d.CheckLeftCollision(left.GetY(), Bar::s_height, leftX, left.GetYVel(), Bar::s_velTransferCoef);
+					hits += d.CheckRightCollision(right.GetY(), Bar::s_height, rightX, right.GetYVel(), Bar::s_velTransferCoef, true, ARENAWIDTH);
+				}
+			}
+			s_sink = s_sink + hits;
+		}, [&]() { dots = initial; });
+	}
+}
+
+static void BenchLogger(Bench& bench)
+{
+	NullBuffer nullBuf;
+	std::ostream nullStream(&nullBuf);
+	Logger& logger = Logger::GetInstGAME();
+
+	bench.Run("logger/print", 1, [&](uint64_t ops) {
+		for (uint64_t i = 0; i < ops; i++)
+			logger.Print("INFO", "Benchmark message of a typical length, about sixty characters", nullStream);
+	});
+	bench.Run("logger/format_print", 1, [&](uint64_t ops) {
+		for (uint64_t i = 0; i < ops; i++)
+			logger.Print("INFO", std::format("Frame time {:.5f}s, ({:.0f} FPS), tick {}", 0.0166f, 60.2f, i).c_str(), nullStream);
+	});
+}
+
+// The background's noise texture, made once per run of the game
+static void BenchNoise(Bench& bench)
+{
+	constexpr uint32_t size = NoiseTexture::s_size;
+	bench.Run(std::format("noise/generate_{}", size), static_cast<uint64_t>(size) * size, [&](uint64_t ops) {
+		std::vector<uint8_t> texels;
+		for (uint64_t i = 0; i < ops; i++) {
+			NoiseTexture::Generate(texels, size, NoiseTexture::s_period);
+			s_sink = s_sink + texels[i % texels.size()];
+		}
+	});
+}
+
+static void BenchGL(Bench& bench, const BenchConfig& cfg, Renderer& rend, Rng& rng)
+{
+	// Own directory, so the game's cache is neither used nor filled
+	ProgramCache cache;
+	const std::filesystem::path cacheDir = std::filesystem::temp_directory_path() / "hyperpong_bench_shaders";
+	cache.Init(cacheDir.string());
+
+	// Raw files are kept in memory, so the preprocess scenarios time the expansion and not the loading
+	std::unordered_map<std::string, std::string> files;
+	auto loader = [&](const std::string& name, std::string& out) {
+		auto it = files.find(name);
+		if (it == files.end()) {
+			if (!ShaderStorage::GetSource(name, cfg.shaderDir, out))
+				return false;
+			it = files.emplace(name, out).first;
+		}
+		out = it->second;
+		return true;
+	};
+	ShaderPreprocessor preprocessor(loader);
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+	for (int t = 0; t < BaseShader_COUNT; t++) {
+		const BaseShaderDesc& desc = ShaderStorage::GetDesc(static_cast<BaseShader>(t));
+		const char* name = desc.name;
+		if (desc.glVersion > static_cast<uint32_t>(major * 100 + minor * 10))
+			continue;
+		const bool isCompute = *desc.vertFile == 0;
+		std::string src, vertSrc;
+		if (!preprocessor.Process(desc.file, desc.defines, src) || (!isCompute && !preprocessor.Process(desc.vertFile, desc.defines, vertSrc)))
+			continue;
+		auto build = [&](Shader& sh, ProgramCache* programCache) {
+			if (isCompute)
+				sh.InitComputeFromSource(src, programCache);
+			else
+				sh.InitFromSource(src, vertSrc, programCache);
+		};
+		bench.Run(std::format("shader/preprocess_{}", name), 1, [&](uint64_t ops) {
+			size_t bytes = 0;
+			for (uint64_t i = 0; i < ops; i++) {
+				ShaderPreprocessor fresh(loader);
+				std::string out;
+				fresh.Process(desc.file, desc.defines, out);
+				bytes += out.size();
+			}
+			s_sink = s_sink + bytes;
+		});
+		// Unchanged files, the output comes from the content hash cache
+		bench.Run(std::format("shader/preprocess_cached_{}", name), 1, [&](uint64_t ops) {
+			size_t bytes = 0;
+			for (uint64_t i = 0; i < ops; i++) {
+				std::string out;
+				preprocessor.Process(desc.file, desc.defines, out);
+				bytes += out.size();
+			}
+			s_sink = s_sink + bytes;
+		});
+		// Compile status is asked for right away, so drivers that compile in the background are waited on too
+		bench.Run(std::format("shader/compile_{}", name), 1, [&](uint64_t ops) {
+			uint32_t ok = 0;
+			for (uint64_t i = 0; i < ops; i++) {
+				Shader sh;
+				build(sh, nullptr);
+				ok += sh.IsOk();
+			}
+			s_sink = s_sink + ok;
+		});
+		if (!cache.IsEnabled())
+			continue;
+		// Warm start, the binary was stored by the first build
+		Shader warm;
+		build(warm, &cache);
+		bench.Run(std::format("shader/cached_{}", name), 1, [&](uint64_t ops) {
+			uint32_t ok = 0;
+			for (uint64_t i = 0; i < ops; i++) {
+				Shader sh;
+				build(sh, &cache);
+				ok += sh.IsOk();
+			}
+			s_sink = s_sink + ok;
+		});
+	}
+	std::error_code err;
+	std::filesystem::remove_all(cacheDir, err);
+
+	// Fill rate of each quality level and render scale, items are window pixels
+	auto [w, h] = rend.GetWindowSize();
+	for (int q = 0; q < BackgroundQuality_COUNT; q++) {
+		for (uint32_t scale : { 1u, 2u, 4u }) {
+			const BackgroundQuality quality = static_cast<BackgroundQuality>(q);
+			const std::string name = std::format("render/background_{}_scale{}", Renderer::GetQualityName(quality), scale);
+			if (!bench.IsSelected(name))
+				continue;
+			rend.SetBackgroundQuality(quality);
+			rend.SetBackgroundScale(scale);
+			rend.FinishShaders();
+			bench.Run(name, static_cast<uint64_t>(w) * h, [&](uint64_t ops) {
+				for (uint64_t i = 0; i < ops; i++) {
+					rend.BeginFrame();
+					rend.BackGroundShader(Sh_Background, Vec2({ w * 0.5f, h * 0.5f }));
+					rend.WaitForPresent();
+				}
+			});
+		}
+	}
+	rend.SetBackgroundQuality(Bg_Procedural);
+	rend.SetBackgroundScale(1);
+
+	// Radial effects on the square around them and on the polygon around the circle, items are wells
+	constexpr uint32_t wellCount = 64;
+	constexpr float wellRad = 88.f;
+	// Own generator, so the quads below stay where they were
+	Rng wellRng(cfg.seed);
+	std::vector<Vec2> wells;
+	for (uint32_t i = 0; i < wellCount; i++)
+		wells.push_back(Vec2({ wellRng.UniformF(wellRad, w - wellRad), wellRng.UniformF(wellRad, h - wellRad) }));
+	bench.Run(std::format("render/blackholes_quad_{}", wellCount), wellCount, [&](uint64_t ops) {
+		for (uint64_t i = 0; i < ops; i++) {
+			rend.BeginFrame();
+			rend.ClearBG(0.0f, 0.0f, 0.0f);
+			for (const Vec2& pos : wells)
+				rend.DrawRectSh(pos + (-wellRad), pos + wellRad, Sh_BlackHole);
+			rend.WaitForPresent();
+		}
+	});
+	bench.Run(std::format("render/blackholes_disc_{}", wellCount), wellCount, [&](uint64_t ops) {
+		for (uint64_t i = 0; i < ops; i++) {
+			rend.BeginFrame();
+			rend.ClearBG(0.0f, 0.0f, 0.0f);
+			for (const Vec2& pos : wells)
+				rend.DrawDiscSh(pos, wellRad, Sh_BlackHoleDisc);
+			rend.WaitForPresent();
+		}
+	});
+
+	// A frame of the particle system at full load, simulated and drawn with nothing read back
+	constexpr uint32_t particleCount = 1 << 20;
+	const std::string particleName = std::format("particles/frame_{}", particleCount);
+	if (bench.IsSelected(particleName)) {
+		rend.SetParticleCapacity(particleCount);
+		rend.FinishShaders();
+		// Long lived, so every frame moves all of them
+		ParticleEmitter burst;
+		burst.count = particleCount;
+		burst.pos = Vec2({ w * 0.5f, h * 0.5f });
+		burst.speed = 300.f;
+		burst.radius = 50.f;
+		burst.life = 1e6f;
+		rend.EmitParticles(burst);
+		rend.BeginFrame();
+		rend.DrawParticles(0.f);
+		const uint32_t spawned = rend.GetParticles().ReadCount();
+		if (spawned != particleCount) {
+			GAME_WARN(std::format("Skipping {}, {} of {} particles spawned", particleName, spawned, particleCount));
+		} else {
+			bench.Run(particleName, particleCount, [&](uint64_t ops) {
+				for (uint64_t i = 0; i < ops; i++) {
+					rend.BeginFrame();
+					rend.ClearBG(0.0f, 0.0f, 0.0f);
+					rend.AddParticleAttractor(Vec2({ w * 0.5f, h * 0.5f }), 3e7f, 1.f);
+					rend.DrawParticles(1.f / 60.f);
+					rend.WaitForPresent();
+				}
+			});
+		}
+		rend.SetParticleCapacity(0);
+	}
+
+	const std::string quadName = std::format("render/quads_{}", cfg.quads);
+	if (!bench.IsSelected(quadName))
+		return;
+	if (!rend.HasShader(Sh_ColorFill)) {
+		GAME_WARN(std::format("Skipping {}, the game's shaders didn't load", quadName));
+		return;
+	}
+	std::vector<std::pair<Vec2, Vec4>> quads;
+	for (uint32_t i = 0; i < cfg.quads; i++) {
+		const Vec2 pos({ rng.UniformF(0.f, static_cast<float>(w)), rng.UniformF(0.f, static_cast<float>(h)) });
+		quads.emplace_back(pos, Vec4({ rng.UniformF(0.f, 1.f), rng.UniformF(0.f, 1.f), rng.UniformF(0.f, 1.f), 1.0f }));
+	}
+	// A frame is done once the GPU has finished it, otherwise only the submission is timed
+	bench.Run(quadName, cfg.quads, [&](uint64_t ops) {
+		for (uint64_t i = 0; i < ops; i++) {
+			rend.BeginFrame();
+			rend.ClearBG(0.0f, 0.0f, 0.0f);
+			for (const auto& [pos, color] : quads)
+				rend.DrawRect(pos + (-Projectile::s_rad), pos + Projectile::s_rad, color);
+			rend.WaitForPresent();
+		}
+	});
+}
+
+static bool ParseArgs(int argc, char** argv, BenchConfig& cfg)
+{
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (arg == "--no-gl") {
+			cfg.useGL = false;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			GAME_ERROR(std::format("Missing value for {}", arg));
+			return false;
+		}
+		const std::string val = argv[++i];
+		// The sto* functions throw on text that isn't a number or doesn't fit
+		try {
+			if (arg == "--warmup") {
+				cfg.warmup = static_cast<uint32_t>(std::stoul(val));
+			} else if (arg == "--reps") {
+				cfg.reps = std::max(1u, static_cast<uint32_t>(std::stoul(val)));
+			} else if (arg == "--min-ms") {
+				cfg.minRepMs = std::stof(val);
+			} else if (arg == "--seed") {
+				cfg.seed = std::stoull(val);
+			} else if (arg == "--filter") {
+				cfg.filter = val;
+			} else if (arg == "--out") {
+				cfg.outFile = val;
+			} else if (arg == "--shaders") {
+				cfg.shaderDir = val;
+			} else if (arg == "--balls") {
+				// Comma separated counts, empty items are skipped
+				cfg.ballCounts.clear();
+				size_t start = 0;
+				while (start <= val.size()) {
+					const size_t end = std::min(val.find(',', start), val.size());
+					if (end > start)
+						cfg.ballCounts.push_back(static_cast<uint32_t>(std::stoul(val.substr(start, end - start))));
+					start = end + 1;
+				}
+				if (cfg.ballCounts.empty()) {
+					GAME_ERROR(std::format("No ball counts in {}", val));
+					return false;
+				}
+			} else if (arg == "--quads") {
+				cfg.quads = static_cast<uint32_t>(std::stoul(val));
+			} else if (arg == "--threads") {
+				cfg.threads = std::stoi(val);
+			} else {
+				GAME_ERROR(std::format("Unknown argument {}", arg));
+				return false;
+			}
+		} catch (const std::logic_error&) {
+			GAME_ERROR(std::format("Invalid value {} for {}", val, arg));
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	BenchConfig cfg;
+	if (!ParseArgs(argc, argv, cfg)) {
+		GAME_INFO("Usage: HyperPongBench [--filter text] [--reps N] [--warmup N] [--min-ms ms] [--seed N] [--out file]");
+		GAME_INFO("       [--balls N,N,...] [--quads N] [--threads N] [--shaders dir] [--no-gl]");
+		return -1;
+	}
+
+	// Same seed, same inputs, so runs of different builds time the same work
+	Rng rng(cfg.seed);
+	JobSystem jobs(cfg.threads);
+	Bench bench(cfg);
+
+	BenchMatrix(bench, rng);
+	BenchPhysics(bench, cfg, jobs, rng);
+	BenchCollisions(bench, cfg, rng);
+	BenchLogger(bench);
+	BenchNoise(bench);
+
+	std::string glRenderer;
+	if (cfg.useGL) {
+		Renderer rend(1280, 720, "HyperPongBench", false, { cfg.shaderDir, "", false });
+		if (rend.IsInitSuccess()) {
+			glRenderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+			// Vsync would time the display instead
+			rend.SetSwapInterval(0);
+			rend.FinishShaders();
+			BenchGL(bench, cfg, rend, rng);
+		} else {
+			GAME_WARN("No OpenGL context, skipping the shader and render scenarios");
+		}
+	}
+
+	if (!bench.WriteJson(glRenderer))
+		return -1;
+	GAME_INFO(std::format("Results written to {}", cfg.outFile));
+	return 0;
+}
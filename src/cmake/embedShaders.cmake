@@ -0,0 +1,26 @@
+# Writes every shader in SHADER_DIR into OUT_FILE as a constexpr table, so the executables don't need the files at run time.
+# Run in script mode: cmake -DSHADER_DIR=dir -DOUT_FILE=file -P embedShaders.cmake
+
+file(GLOB SHADER_FILES RELATIVE "${SHADER_DIR}" "${SHADER_DIR}/*.frag" "${SHADER_DIR}/*.vert" "${SHADER_DIR}/*.glsl" "${SHADER_DIR}/*.comp")
+list(SORT SHADER_FILES)
+list(LENGTH SHADER_FILES SHADER_COUNT)
+
+set(ENTRIES "")
+foreach(NAME ${SHADER_FILES})
+	file(READ "${SHADER_DIR}/${NAME}" SRC)
+	string(FIND "${SRC}" ")hpsh\"" CLASH)
+	if(NOT CLASH EQUAL -1)
+		message(FATAL_ERROR "${NAME} contains the raw string delimiter )hpsh\"")
+	endif()
+	string(APPEND ENTRIES "\t\tstd::make_pair(std::string_view(\"${NAME}\"), std::string_view(R\"hpsh(${SRC})hpsh\")),\n")
+endforeach()
+
+set(CONTENT "#pragma once\n\n// Generated from res/shaders by embedShaders.cmake, edit the shader files instead\n\n#include <array>\n#include <string_view>\n#include <utility>\n\nnamespace EmbeddedShaders {\n\tinline constexpr std::array<std::pair<std::string_view, std::string_view>, ${SHADER_COUNT}> s_files = {\n${ENTRIES}\t};\n\n\t/** Source of the shader file, empty if there is no such file */\n\tconstexpr std::string_view Find(std::string_view name)\n\t{\n\t\tfor (const auto& [fName, src] : s_files) {\n\t\t\tif (fName == name)\n\t\t\t\treturn src;\n\t\t}\n\t\treturn {};\n\t}\n}\n")
+
+# Only touched when the sources changed, so the renderer isn't rebuilt for nothing
+if(EXISTS "${OUT_FILE}")
+	file(READ "${OUT_FILE}" OLD_CONTENT)
+endif()
+if(NOT "${OLD_CONTENT}" STREQUAL "${CONTENT}")
+	file(WRITE "${OUT_FILE}" "${CONTENT}")
+endif()
@@ -1,14 +1,117 @@
 #include "game.h"
-#include "projectile.h"
-#include "playerBar.h"
+#include "simulation.h"
+#include "replay.h"
+#include "Utils/mappedFile.h"
+#include "Utils/fileIO.h"
 #include "Utils/logger.h"
 
 #define BASEWIDTH 1600
 #define BASEHEIGHT 900
 
-Game::Game()
-    : m_renderer(BASEWIDTH, BASEHEIGHT, "Hyper Pong")
+#define QUICKSAVE_FILE "quicksave.hpst"
+#define FRAMESTATS_FILE "frame_stats.csv"
+
+// Fixed simulation rate in ticks per second
+#define SIM_TICKRATE 240
+
+static void DrawDot(Renderer& rend, const DotState& dot)
+{
+    constexpr float rad = Projectile::s_rad;
+    const Vec2& pos = dot.pos;
+    const Vec2& vel = dot.vel;
+    rend.DrawRect(pos + (-rad), pos + rad, Vec4({vel[0] / Projectile::s_speed, vel[1] / Projectile::s_speed, pos[1] / 1000.f, 1.0f}));
+}
+
+static void DrawBar(Renderer& rend, const BarState& bar)
+{
+    constexpr float size = Bar::s_size;
+    float x = bar.isLeft ? 2 * size : static_cast<float>(rend.GetWindowWidth()) - 2 * size;
+    const Vec2 bar1mid({x, bar.yPos });
+    const Vec2 barCornOffset({ size, Bar::s_height });
+    rend.DrawRect(bar1mid - barCornOffset, bar1mid + barCornOffset);
+}
+
+// Trails behind the dots, bursts where they bounce off a bar and rings spiralling into the wells
+static void EmitParticles(Renderer& rend, const GameSnapshot& snap, const std::vector<DotState>& prevDots, float dt)
+{
+    constexpr float ppm = Integration::s_pixPerMeter;
+    const float w = static_cast<float>(rend.GetWindowWidth());
+    const float barZone = 6 * Bar::s_size + Projectile::s_rad;
+    // Dots only match up by index while none are added or removed
+    const bool sameDots = prevDots.size() == snap.dots.size();
+    for (size_t i = 0; sameDots && i < snap.dots.size(); i++) {
+        const DotState& d = snap.dots[i];
+        const DotState& prev = prevDots[i];
+        const float dist = (d.pos - prev.pos).length();
+        const Vec4 color({ std::abs(d.vel[0]) / Projectile::s_speed, std::abs(d.vel[1]) / Projectile::s_speed, d.pos[1] / 1000.f, 0.6f });
+        // A longer jump is a respawn or a quick load
+        if (dist > 0.f && dist < 200.f) {
+            ParticleEmitter trail;
+            trail.kind = Emit_Trail;
+            trail.count = std::min(static_cast<uint32_t>(dist * 0.5f) + 1, 64u);
+            trail.from = prev.pos;
+            trail.pos = d.pos;
+            trail.vel = d.vel * (0.1f * ppm);
+            trail.speed = 20.f;
+            trail.life = 0.4f;
+            trail.color = color;
+            rend.EmitParticles(trail);
+        }
+        const bool leftHit = prev.vel[0] < 0.f && d.vel[0] > 0.f && d.pos[0] < barZone;
+        const bool rightHit = prev.vel[0] > 0.f && d.vel[0] < 0.f && d.pos[0] > w - barZone;
+        if (leftHit || rightHit) {
+            ParticleEmitter burst;
+            burst.kind = Emit_Burst;
+            burst.count = 256;
+            burst.pos = d.pos;
+            burst.dir = Vec2({ leftHit ? 1.f : -1.f, 0.f });
+            burst.spread = 2.f;
+            burst.speed = 400.f;
+            burst.radius = Projectile::s_rad;
+            burst.life = 0.6f;
+            burst.size = 2.5f;
+            burst.color = Vec4({ 1.f, 0.8f, 0.4f, 0.9f });
+            rend.EmitParticles(burst);
+        }
+    }
+
+    for (const GravityWell& well : snap.wells) {
+        // Same pull as the dots feel, converted to pixels
+        const float strength = well.mass * ppm * ppm * ppm;
+        const float ringRad = well.drawRad * 1.1f;
+        ParticleEmitter ring;
+        ring.kind = Emit_Ring;
+        ring.count = static_cast<uint32_t>(2000.f * dt) + 1;
+        ring.pos = well.pos;
+        ring.radius = ringRad;
+        // A bit below orbital speed, so they spiral in
+        ring.speed = 0.8f * std::sqrt(strength / ringRad);
+        ring.life = 1.5f;
+        ring.size = 1.5f;
+        ring.color = Vec4({ 1.f, 0.55f, 0.2f, 0.5f });
+        rend.EmitParticles(ring);
+        // Swallowed at the singularity, a fifth of the drawn radius like the simulation's capture
+        rend.AddParticleAttractor(well.pos, strength, well.drawRad * 0.2f);
+    }
+}
+
+Game::Game(const GameOptions& options)
+    : m_renderer(BASEWIDTH, BASEHEIGHT, "Hyper Pong", true, options.shaders),
+    m_jobs(),
+    m_snapshots(),
+    m_quit(false),
+    m_integrator(Int_SemiImplicitEuler),
+    m_options(options),
+    m_input(),
+    m_stats(),
+    m_overlay()
 {
+    // The context is still current on this thread until Run hands it over
+    if (m_renderer.IsInitSuccess() && !m_overlay.Init())
+        GAME_WARN("Debug overlay could not be created");
+    m_renderer.SetBackgroundQuality(options.background);
+    m_renderer.SetBackgroundScale(options.backgroundScale);
+    m_renderer.SetParticleCapacity(options.particles);
 }
 
 int Game::Run()
@@ -16,10 +119,60 @@ int Game::Run()
     if (!m_renderer.IsInitSuccess())
         return -1;
 
-    GAME_INFO("Game started");
+    if (m_options.isOnline && (!m_options.playFile.empty() || !m_options.recordFile.empty())) {
+        GAME_WARN("Replays aren't supported in online matches, ignoring them");
+        m_options.playFile.clear();
+        m_options.recordFile.clear();
+    }
+
+    // A replay brings its own seed and integrator
+    ReplayReader replayIn;
+    uint64_t seed = m_options.seed;
+    if (!m_options.playFile.empty()) {
+        if (!replayIn.Open(m_options.playFile))
+            return -1;
+        if (replayIn.GetHeader().tickRate != SIM_TICKRATE)
+            GAME_WARN(std::format("Replay was recorded at {} ticks/s instead of {}, it won't play back exactly", replayIn.GetHeader().tickRate, SIM_TICKRATE));
+        seed = replayIn.GetHeader().seed;
+        m_integrator = replayIn.GetHeader().integrator;
+        GAME_INFO(std::format("Playing back {}", m_options.playFile));
+    }
+
+    ReplayWriter replayOut;
+    if (!m_options.recordFile.empty()) {
+        if (!replayOut.Open(m_options.recordFile, { SIM_TICKRATE, m_integrator, seed }))
+            return -1;
+        GAME_INFO(std::format("Recording to {}", m_options.recordFile));
+    }
+
+    GAME_INFO(std::format("Game started with seed {}, integrating with {}", seed, Integration::GetName(m_integrator)));
+
+    // Physics in the base resolution, the arena follows the window size later
+    Simulation sim(static_cast<float>(BASEWIDTH), static_cast<float>(BASEHEIGHT), seed, m_integrator);
+    sim.Serve();
+
+    // Online the session has its own simulation once the peers have found each other, the host's seed is used
+    std::unique_ptr<NetPeer> net;
+    if (m_options.isOnline) {
+        net = std::make_unique<NetPeer>(m_options.net, seed, static_cast<float>(BASEWIDTH), static_cast<float>(BASEHEIGHT), m_integrator, 1.f / SIM_TICKRATE);
+        if (!net->Open())
+            return -1;
+    }
+    // Spectators get interpolated states from the broadcasting game instead of simulating
+    std::unique_ptr<SpectatorClient> spectator;
+    if (!m_options.spectateHost.empty()) {
+        NetAddress server;
+        spectator = std::make_unique<SpectatorClient>();
+        if (!UdpSocket::Resolve(m_options.spectateHost, m_options.spectatePort, server) || !spectator->Open(server, 1.f / SIM_TICKRATE))
+            return -1;
+        GAME_INFO(std::format("Spectating {}", server.ToString()));
+    }
+    SpectatorServer broadcast;
+    if (m_options.broadcastPort != 0 && !broadcast.Start(m_options.broadcastPort, SIM_TICKRATE / 60))
+        return -1;
 
-    // Game projectile (dot)
-    Projectile dot(m_renderer, static_cast<float>(BASEHEIGHT));
+    // What is shown, the local simulation until an online match has started
+    auto shownSim = [&sim, &net]() -> const Simulation& { return net && net->GetSession().IsRunning() ? net->GetSession().GetSim() : sim; };
 
     //Vec2 gravity({ 0.0f, -9.5f });
 
@@ -27,106 +180,267 @@ int Game::Run()
     //float strength = 0.2f;
     //float springLength = 250.f;
 
-    // Bars
-    Bar leftBar(m_renderer, static_cast<float>(BASEHEIGHT), true);
-    Bar rightBar(m_renderer, static_cast<float>(BASEHEIGHT), false);
+    // Previous tick's input for noticing key presses
+    InputFrame prevFrame;
 
-    // Black hole in the middle
-    Vec2 bhPos({0.5f * BASEWIDTH, 0.5f * BASEHEIGHT});
-    constexpr float bhMass = 0.03f;
-    constexpr float bhSize = 88.f;
+    uint32_t shaderResets = 0;
+    bool showOverlay = false;
 
-    // A bit hacky way to get key presses
-    bool r_down = false, i_down = false;
+    // The render thread takes the GL context over until the game ends
+    m_renderer.ReleaseContext();
+    m_quit = false;
+    std::thread renderThread(&Game::RenderLoop, this);
 
-    bool isTwoPlayer = true;
+    // Simulation runs on this thread at a fixed rate, it has to since GLFW events and input are main thread only
+    constexpr float dt = 1.f / SIM_TICKRATE;
+    const auto tickDur = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(dt));
+    const auto startTime = std::chrono::steady_clock::now();
+    auto nextTick = startTime;
 
     while (!m_renderer.WindowShouldClose()) {
-        m_renderer.ClearBG(0.0f, 0.0f, 0.0f);
-        m_renderer.BackGroundShader(Sh_Background, dot.GetPos());
+        m_renderer.PollEvents();
 
-        float dt = m_renderer.GetFrameTime();
-        Vec2 curs = m_renderer.GetMousePos();
+        InputFrame frame = this->ReadInput();
+        if (replayIn.IsOpen() && !replayIn.Next(frame)) {
+            GAME_INFO("Replay finished, back to live input");
+            replayIn = ReplayReader();
+        }
+        if (replayOut.IsOpen())
+            replayOut.Record(frame);
+        auto pressed = [&frame, &prevFrame](InputKey key) { return frame.IsDown(key) && !prevFrame.IsDown(key); };
 
-        // Info stuff in I key press or laggy frames
-        if (m_renderer.IsKeyDown(KEY_I) && !i_down || dt > 1.f / 20.f) {
-            GAME_INFO(std::format("Frame time {:.5f}s, ({:.0f} FPS), elapsed {:.5f}s", dt, 1.f / dt, m_renderer.GetElapsedSecs()));
+        // Info stuff in I key press
+        if (pressed(In_I)) {
+            float frameTime = m_renderer.GetFrameTime();
+            GAME_INFO(std::format("Frame time {:.5f}s, ({:.0f} FPS), elapsed {:.5f}s", frameTime, 1.f / frameTime, m_renderer.GetElapsedSecs()));
+            this->LogStats();
+            const Projectile& dot = shownSim().GetDots().front();
             Vec2 dotPos = dot.GetPos();
-            GAME_INFO(std::format("Mouse at ({}, {}), dot at ({}, {}), dot speed {}", curs[0], curs[1], dotPos[0], dotPos[1], dot.GetVel().length()));
+            GAME_INFO(std::format("Mouse at ({}, {}), dot at ({}, {}), dot speed {}", frame.mouseX, frame.mouseY, dotPos[0], dotPos[1], dot.GetVel().length()));
         }
-        i_down = m_renderer.IsKeyDown(KEY_I);
-
-        auto [w, h] = m_renderer.GetWindowSize();
 
-        // Shader reset in R press
-        if (m_renderer.IsKeyDown(KEY_R) && !r_down) {
-            m_renderer.ResetShaders();
+        // Shader reset in R press, done by the render thread when it sees the counter change
+        if (pressed(In_R)) {
+            shaderResets++;
             GAME_INFO("Resetting shaders");
         }
-        r_down = m_renderer.IsKeyDown(KEY_R);
-
-        // Select 1/2 player mode
-        if (m_renderer.IsKeyDown(KEY_1))
-            isTwoPlayer = false;
-        else if (m_renderer.IsKeyDown(KEY_2))
-            isTwoPlayer = true;
-
-        // Player 1 (left) controls
-        if (m_renderer.IsKeyDown(KEY_W) || (!isTwoPlayer && m_renderer.IsKeyDown(KEY_UP))) {
-            leftBar.Up(dt);
-        } else if (m_renderer.IsKeyDown(KEY_S) || (!isTwoPlayer && m_renderer.IsKeyDown(KEY_DOWN))) {
-            leftBar.Down(dt);
-        } else {
-            leftBar.Brake(dt);
-        }
+        prevFrame = frame;
 
-        // Player 2 (right) controls
-        if (isTwoPlayer && m_renderer.IsKeyDown(KEY_UP)) {
-            rightBar.Up(dt);
-        } else if (isTwoPlayer && m_renderer.IsKeyDown(KEY_DOWN)) {
-            rightBar.Down(dt);
-        } else {
-            rightBar.Brake(dt);
+        if (m_input.WasPressed(KEY_F3))
+            showOverlay = !showOverlay;
+
+        // Quick save and load, outside the input frame since a load can't be replayed from input alone
+        const bool offline = !net && !spectator;
+        if (offline && m_input.WasPressed(KEY_F5))
+            this->QuickSave(sim);
+        if (offline && m_input.WasPressed(KEY_F9) && this->QuickLoad(sim)) {
+            if (replayOut.IsOpen()) {
+                GAME_WARN("Stopped recording since the replay can't follow a quick load");
+                replayOut.Close();
+            }
+            if (replayIn.IsOpen()) {
+                GAME_WARN("Stopped the replay since it can't follow a quick load, back to live input");
+                replayIn = ReplayReader();
+            }
         }
 
         // Gravity (Downwards)
         //dotVel = dotVel + (gravity * dt);
 
-        // Gravity towards black hole
-        dot.GravityToPoint(bhPos, bhMass, dt);
-
         // Attraction to cursor
         //Vec2 diff = curs - dotPos;
         ////float activeDist = std::max(diff.length() - springLength, 0.0f) * 0.001f;
         //float activeDist = (diff.length() - springLength) * 0.001f;
         //Vec2 acc = diff * activeDist * strength;
         //dotVel = (dotVel + (acc * std::min(dt, 1 / 60.f)));
-        
-        // Air res at larger speeds to slow the dot down
-        dot.ApplyAirRes(1.f, dt);
 
-        dot.CheckYCollision(static_cast<float>(h));
+        const auto simStart = std::chrono::steady_clock::now();
+        const double secs = std::chrono::duration<double>(simStart - startTime).count();
+        if (spectator) {
+            spectator->Poll(secs);
+        } else if (net) {
+            // Either set of keys moves our own bar
+            BarControl ctrl = Ctrl_Brake;
+            if (frame.IsDown(In_W) || frame.IsDown(In_Up))
+                ctrl = Ctrl_Up;
+            else if (frame.IsDown(In_S) || frame.IsDown(In_Down))
+                ctrl = Ctrl_Down;
+            net->Tick(ctrl, secs, &m_jobs);
+        } else {
+            sim.StepFrame(frame, dt, &m_jobs);
+        }
 
-        dot.CheckLeftCollision(leftBar.GetY(), Bar::s_height, leftBar.GetCollisionX(), leftBar.GetYVel(), Bar::s_velTransferCoef);
-        dot.CheckRightCollision(rightBar.GetY(), Bar::s_height, rightBar.GetCollisionX(), rightBar.GetYVel(), Bar::s_velTransferCoef, isTwoPlayer, static_cast<float>(w));
+        m_stats.Record(Stat_Sim, std::chrono::duration<float>(std::chrono::steady_clock::now() - simStart).count());
 
-        dot.Advance(dt);
-        
-        // Draw the dot and bars
-        dot.Draw();
-        leftBar.Draw();
-        if (isTwoPlayer)
-            rightBar.Draw();
+        // Only copies into a buffer, the server thread does the sending
+        if (m_options.broadcastPort != 0)
+            broadcast.Publish(shownSim());
 
-        m_renderer.DrawRectSh(bhPos - bhSize, bhPos + bhSize, Sh_BlackHole);
+        // Hand the tick over to the render thread
+        GameSnapshot& snap = m_snapshots.GetBack();
+        if (!spectator || !spectator->Sample(secs, snap))
+            shownSim().FillSnapshot(snap);
+        snap.simTime = snap.tick * dt;
+        snap.shaderResets = shaderResets;
+        snap.showOverlay = showOverlay;
+        m_snapshots.Publish();
 
-        m_renderer.SwapAndPoll();
+        // Don't try to catch up after a long stall, just continue from now
+        nextTick += tickDur;
+        auto now = std::chrono::steady_clock::now();
+        if (now - nextTick > 8 * tickDur)
+            nextTick = now;
+        std::this_thread::sleep_until(nextTick);
     }
 
+    m_quit = true;
+    renderThread.join();
+    m_renderer.MakeContextCurrent();
+
+    this->LogStats();
+    if (m_stats.WriteCsv(FRAMESTATS_FILE))
+        GAME_INFO(std::format("Frame statistics written to {}", FRAMESTATS_FILE));
+
     return 0;
 }
 
+void Game::RenderLoop()
+{
+    m_renderer.MakeContextCurrent();
+
+    FramePacer pacer(m_options.pacing, m_options.fpsCap, m_renderer.GetRefreshRate());
+    m_renderer.SetSwapInterval(pacer.GetSwapInterval());
+    GAME_INFO(std::format("Frame pacing {}, refresh rate {}Hz", FramePacer::GetName(pacer.GetMode()), m_renderer.GetRefreshRate()));
+
+    uint32_t shaderResets = 0;
+    bool hasSnapshot = false;
+    uint64_t frames = 0;
+    std::vector<DotState> prevDots;
+
+    while (!m_quit) {
+        // Capped and late latch modes wait here, before the newest state is picked up
+        pacer.WaitForFrameStart();
+        hasSnapshot |= m_snapshots.Acquire();
+        if (!hasSnapshot) {
+            std::this_thread::yield();
+            continue;
+        }
+        const GameSnapshot& snap = m_snapshots.GetFront();
+
+        m_renderer.BeginFrame();
+        const auto renderStart = std::chrono::steady_clock::now();
+
+        float frameTime = m_renderer.GetFrameTime();
+        if (frames++ > 0)
+            m_stats.Record(Stat_Frame, frameTime);
+        if (frameTime > 1.f / 20.f)
+            GAME_INFO(std::format("Laggy frame {:.5f}s, ({:.0f} FPS), tick {}", frameTime, 1.f / frameTime, snap.tick));
+
+        if (snap.shaderResets != shaderResets) {
+            m_renderer.ResetShaders();
+            shaderResets = snap.shaderResets;
+        }
+
+        m_renderer.BeginGpuPass(Pass_Background);
+        m_renderer.ClearBG(0.0f, 0.0f, 0.0f);
+        m_renderer.BackGroundShader(Sh_Background, snap.dots.front().pos);
+        m_renderer.BeginGpuPass(Pass_Entities);
+
+        // Draw the dots and bars
+        for (const DotState& d : snap.dots)
+            DrawDot(m_renderer, d);
+        DrawBar(m_renderer, snap.leftBar);
+        if (snap.isTwoPlayer)
+            DrawBar(m_renderer, snap.rightBar);
+
+        for (const GravityWell& well : snap.wells)
+            m_renderer.DrawDiscSh(well.pos, well.drawRad, Sh_BlackHoleDisc);
+
+        // Long stalls are stepped as a short frame, particles don't need to catch up
+        m_renderer.BeginGpuPass(Pass_Particles);
+        const float particleDt = std::min(frameTime, 1.f / 20.f);
+        EmitParticles(m_renderer, snap, prevDots, particleDt);
+        m_renderer.DrawParticles(particleDt);
+        prevDots = snap.dots;
+
+        // Timed on its own so that the overlay's cost can be told apart from the game's
+        if (snap.showOverlay) {
+            m_renderer.BeginGpuPass(Pass_Overlay);
+            const auto overlayStart = std::chrono::steady_clock::now();
+            m_overlay.Draw(m_renderer, m_stats, snap);
+            m_stats.Record(Stat_Overlay, std::chrono::duration<float>(std::chrono::steady_clock::now() - overlayStart).count());
+        }
+        m_renderer.EndGpuPass();
+
+        // Blocks on vsync while the simulation carries on
+        pacer.EndWork();
+        m_stats.Record(Stat_Render, std::chrono::duration<float>(std::chrono::steady_clock::now() - renderStart).count());
+        m_renderer.Swap();
+        if (pacer.NeedsPresentWait())
+            m_renderer.WaitForPresent();
+        pacer.OnPresented();
+    }
+
+    m_renderer.ReleaseContext();
+}
+
+void Game::LogStats() const
+{
+    for (int ch = 0; ch < StatChannel_COUNT; ch++) {
+        const StatSummary s = m_stats.GetSummary(static_cast<StatChannel>(ch));
+        GAME_INFO(std::format("{} times over {} samples: p50 {:.3f}ms, p95 {:.3f}ms, p99 {:.3f}ms, max {:.3f}ms, {} hitches",
+            FrameStats::GetName(static_cast<StatChannel>(ch)), s.count, s.p50 * 1e3f, s.p95 * 1e3f, s.p99 * 1e3f, s.max * 1e3f, s.hitches));
+    }
+}
+
 bool Game::Init()
 {
     return true;
 }
+
+void Game::QuickSave(const Simulation& sim)
+{
+    std::vector<uint64_t> state;
+    sim.SaveState(state);
+    if (!FileIO::WriteFile(QUICKSAVE_FILE, state.data(), state.size() * sizeof(uint64_t)))
+        return;
+    GAME_INFO(std::format("Saved tick {} to {}", sim.GetTick(), QUICKSAVE_FILE));
+}
+
+bool Game::QuickLoad(Simulation& sim)
+{
+    // Read in place from the mapping
+    MappedFile file;
+    if (!file.Open(QUICKSAVE_FILE) || !sim.LoadState(file.GetData(), file.GetSize()))
+        return false;
+    GAME_INFO(std::format("Loaded tick {} from {}", sim.GetTick(), QUICKSAVE_FILE));
+    return true;
+}
+
+InputFrame Game::ReadInput()
+{
+    constexpr std::pair<Key, InputKey> keyMap[] = {
+        { KEY_W, In_W }, { KEY_S, In_S }, { KEY_UP, In_Up }, { KEY_DOWN, In_Down },
+        { KEY_1, In_1 }, { KEY_2, In_2 }, { KEY_R, In_R }, { KEY_I, In_I }
+    };
+
+    // Everything that happened since the previous tick, in order
+    m_input.BeginTick();
+    InputEvent ev;
+    while (m_renderer.PopInputEvent(ev))
+        m_input.Apply(ev);
+
+    // Presses shorter than a tick still show up as down for one tick
+    InputFrame frame;
+    for (auto [key, bit] : keyMap) {
+        if (m_input.IsDown(key))
+            frame.keys |= bit;
+    }
+    const Vec2& curs = m_input.GetMousePos();
+    frame.mouseX = static_cast<int16_t>(std::lround(curs[0]));
+    frame.mouseY = static_cast<int16_t>(std::lround(curs[1]));
+    auto [w, h] = m_renderer.GetWindowSize();
+    frame.arenaW = static_cast<uint16_t>(w);
+    frame.arenaH = static_cast<uint16_t>(h);
+    return frame;
+}
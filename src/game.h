@@ -1,17 +1,59 @@
 #pragma once
 
 #include "OpenGL/renderer.h"
+#include "OpenGL/debugOverlay.h"
+#include "Utils/jobSystem.h"
+#include "Utils/tripleBuffer.h"
+#include "Utils/framePacer.h"
+#include "Utils/frameStats.h"
+#include "gameState.h"
+#include "integrator.h"
+#include "Net/netPeer.h"
+#include "Net/spectator.h"
+
+class Simulation;
+
+struct GameOptions
+{
+	uint64_t seed = 0;
+	std::string recordFile;	// Replay output, nothing recorded if empty
+	std::string playFile;	// Replay to play back instead of live input
+	bool isOnline = false;	// Networked two player match, replays and quick saves are off then
+	NetOptions net;
+	uint16_t broadcastPort = 0;		// Streams the game to spectators when set
+	std::string spectateHost;		// Watches a broadcast instead of playing when set
+	uint16_t spectatePort = 0;
+	PacingMode pacing = Pace_VSync;
+	float fpsCap = 0.f;				// For the capped pacing
+	ShaderConfig shaders;
+	BackgroundQuality background = Bg_Procedural;
+	uint32_t backgroundScale = 1;	// Drawn at 1 / scale of the resolution and upsampled
+	uint32_t particles = 1 << 18;	// Capacity of the particle system, 0 turns it off
+};
 
 class Game
 {
 public:
-	Game();
+	explicit Game(const GameOptions& options);
 	~Game() = default;
 
 	int Run();
 
 private:
 	Renderer m_renderer;
+	JobSystem m_jobs;
+	TripleBuffer<GameSnapshot> m_snapshots;	// Simulation thread writes, render thread reads
+	std::atomic<bool> m_quit;
+	Integrator m_integrator;
+	GameOptions m_options;
+	InputState m_input;		// Main thread only, rebuilt from the renderer's events every tick
+	FrameStats m_stats;
+	DebugOverlay m_overlay;	// Used by the render thread, destroyed before the renderer
 private:
 	bool Init();
+	InputFrame ReadInput();
+	void QuickSave(const Simulation& sim);
+	bool QuickLoad(Simulation& sim);
+	void RenderLoop();
+	void LogStats() const;
 };
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Utils/matrix.h"
+
+struct GravityWell
+{
+	Vec2 pos;
+	float mass;
+	float drawRad;	// Size of the drawn effect in pixels
+};
+
+struct DotState
+{
+	Vec2 pos;
+	Vec2 vel;
+};
+
+struct BarState
+{
+	float yPos;
+	float yVel;
+	bool isLeft;
+};
+
+enum BarControl : uint8_t
+{
+	Ctrl_Brake = 0,
+	Ctrl_Up,
+	Ctrl_Down
+};
+
+/** Player controls for one simulation tick */
+struct TickInput
+{
+	BarControl left = Ctrl_Brake;
+	BarControl right = Ctrl_Brake;
+};
+
+enum InputKey : uint16_t
+{
+	In_W = 1 << 0,
+	In_S = 1 << 1,
+	In_Up = 1 << 2,
+	In_Down = 1 << 3,
+	In_1 = 1 << 4,
+	In_2 = 1 << 5,
+	In_R = 1 << 6,
+	In_I = 1 << 7
+};
+
+/** Raw input of one tick, everything the simulation reads from the outside, so it can be recorded and replayed */
+struct InputFrame
+{
+	uint16_t keys = 0;	// InputKey bits
+	int16_t mouseX = 0, mouseY = 0;
+	uint16_t arenaW = 0, arenaH = 0;	// Window size, the arena follows it
+
+	inline bool IsDown(InputKey key) const { return (keys & key) != 0; }
+	bool operator==(const InputFrame& other) const = default;
+};
+
+/** Everything the render thread needs from one simulation tick */
+struct GameSnapshot
+{
+	uint64_t tick = 0;
+	float simTime = 0.0f;
+	std::vector<DotState> dots;
+	std::vector<GravityWell> wells;
+	BarState leftBar{};
+	BarState rightBar{};
+	bool isTwoPlayer = true;
+	uint32_t shaderResets = 0;	// Bumped by the simulation on every reset request
+	bool showOverlay = false;
+};
@@ -0,0 +1,239 @@
+#include "golden.h"
+#include "simulation.h"
+#include "replay.h"
+#include "Utils/logger.h"
+#include "Utils/random.h"
+#include "Utils/fileIO.h"
+#include "Utils/byteOrder.h"
+
+#include <algorithm>
+#include <bit>
+
+static constexpr char s_magic[4] = { 'H', 'P', 'G', 'D' };
+static constexpr uint16_t s_version = 1;
+static constexpr size_t s_headerSize = sizeof(s_magic) + 2 + 2 + 4 + 4 + 8 + 4 + 4 + 1 + 4;
+
+static void PutF32(std::vector<uint8_t>& buf, float v)
+{
+	ByteOrder::PutLE(buf, std::bit_cast<uint32_t>(v), 4);
+}
+
+static float GetF32(const uint8_t* data)
+{
+	return std::bit_cast<float>(static_cast<uint32_t>(ByteOrder::GetLE(data, 4)));
+}
+
+bool Golden::Run(const std::string& replayFile, const GoldenHeader& header, JobSystem* jobs, GoldenTrajectory& out)
+{
+	ReplayReader replay;
+	if (!replay.Open(replayFile))
+		return false;
+	const ReplayHeader& rh = replay.GetHeader();
+	const float dt = 1.f / rh.tickRate;
+	const uint32_t sampleEvery = std::max<uint32_t>(header.sampleEvery, 1);
+
+	Simulation sim(header.arenaW, header.arenaH, rh.seed, rh.integrator);
+	sim.Serve();
+	// The extra dots come from their own stream so that the simulation's generator stays as in a normal game
+	Rng spawn = RngService(rh.seed).Stream(1);
+	for (uint32_t i = 1; i < header.dotCount; i++) {
+		const float dir = spawn.UniformF(0.f, 6.2831853f);
+		sim.AddDot({ Vec2({ spawn.UniformF(50.f, header.arenaW - 50.f), spawn.UniformF(20.f, header.arenaH - 20.f) }),
+			Vec2({ Projectile::s_speed * std::cos(dir), Projectile::s_speed * std::sin(dir) }) });
+	}
+
+	out.header = header;
+	out.header.sampleEvery = sampleEvery;
+	out.samples.clear();
+
+	GoldenSample pending;
+	InputFrame frame;
+	while ((header.ticks == 0 || sim.GetTick() < header.ticks) && replay.Next(frame)) {
+		const SimEvents ev = sim.StepFrame(frame, dt, header.useJobs ? jobs : nullptr);
+		pending.barHits += ev.barHits;
+		pending.events |= (ev.leftMiss ? Ge_LeftMiss : 0) | (ev.rightMiss ? Ge_RightMiss : 0) | (ev.captured ? Ge_Captured : 0);
+		if (header.dotCount == 1 && (ev.leftMiss || ev.rightMiss || ev.captured))
+			sim.Serve();
+
+		if (sim.GetTick() % sampleEvery == 0) {
+			pending.tick = sim.GetTick();
+			pending.leftBar = sim.GetLeftBar().GetState();
+			pending.rightBar = sim.GetRightBar().GetState();
+			pending.dots.clear();
+			for (const Projectile& d : sim.GetDots())
+				pending.dots.push_back(d.GetState());
+			out.samples.push_back(std::move(pending));
+			pending = GoldenSample();
+		}
+	}
+	if (header.ticks != 0 && sim.GetTick() < header.ticks) {
+		GAME_ERROR(std::format("Replay {} ended after {} ticks of {}", replayFile, sim.GetTick(), header.ticks));
+		return false;
+	}
+	out.header.ticks = sim.GetTick();
+	return true;
+}
+
+bool Golden::Write(const std::string& fName, const GoldenTrajectory& trajectory)
+{
+	const GoldenHeader& h = trajectory.header;
+	std::vector<uint8_t> buf;
+	for (char c : s_magic)
+		buf.push_back(static_cast<uint8_t>(c));
+	ByteOrder::PutLE(buf, s_version, 2);
+	ByteOrder::PutLE(buf, s_headerSize, 2);
+	ByteOrder::PutLE(buf, h.dotCount, 4);
+	ByteOrder::PutLE(buf, h.sampleEvery, 4);
+	ByteOrder::PutLE(buf, h.ticks, 8);
+	PutF32(buf, h.arenaW);
+	PutF32(buf, h.arenaH);
+	ByteOrder::PutLE(buf, h.useJobs, 1);
+	ByteOrder::PutLE(buf, trajectory.samples.size(), 4);
+
+	for (const GoldenSample& s : trajectory.samples) {
+		ByteOrder::PutLE(buf, s.tick, 8);
+		ByteOrder::PutLE(buf, s.barHits, 4);
+		ByteOrder::PutLE(buf, s.events, 1);
+		PutF32(buf, s.leftBar.yPos);
+		PutF32(buf, s.leftBar.yVel);
+		PutF32(buf, s.rightBar.yPos);
+		PutF32(buf, s.rightBar.yVel);
+		ByteOrder::PutLE(buf, s.dots.size(), 4);
+		for (const DotState& d : s.dots) {
+			PutF32(buf, d.pos[0]);
+			PutF32(buf, d.pos[1]);
+			PutF32(buf, d.vel[0]);
+			PutF32(buf, d.vel[1]);
+		}
+	}
+
+	return FileIO::WriteFile(fName, buf.data(), buf.size());
+}
+
+bool Golden::Read(const std::string& fName, GoldenTrajectory& out)
+{
+	std::vector<uint8_t> data;
+	if (!FileIO::ReadFile(fName, data))
+		return false;
+
+	if (data.size() < s_headerSize || memcmp(data.data(), s_magic, sizeof(s_magic)) != 0 || ByteOrder::GetLE(&data[4], 2) != s_version) {
+		GAME_ERROR(std::format("{} is not a version {} golden trajectory", fName, s_version));
+		return false;
+	}
+	size_t at = ByteOrder::GetLE(&data[6], 2);
+	GoldenHeader& h = out.header;
+	h.dotCount = static_cast<uint32_t>(ByteOrder::GetLE(&data[8], 4));
+	h.sampleEvery = static_cast<uint32_t>(ByteOrder::GetLE(&data[12], 4));
+	h.ticks = ByteOrder::GetLE(&data[16], 8);
+	h.arenaW = GetF32(&data[24]);
+	h.arenaH = GetF32(&data[28]);
+	h.useJobs = data[32] != 0;
+	const uint64_t sampleCount = ByteOrder::GetLE(&data[33], 4);
+
+	constexpr size_t sampleFixed = 8 + 4 + 1 + 4 * 4 + 4;
+	out.samples.clear();
+	for (uint64_t i = 0; i < sampleCount; i++) {
+		if (at + sampleFixed > data.size())
+			break;
+		GoldenSample s;
+		s.tick = ByteOrder::GetLE(&data[at], 8);
+		s.barHits = static_cast<uint32_t>(ByteOrder::GetLE(&data[at + 8], 4));
+		s.events = data[at + 12];
+		s.leftBar = { GetF32(&data[at + 13]), GetF32(&data[at + 17]), true };
+		s.rightBar = { GetF32(&data[at + 21]), GetF32(&data[at + 25]), false };
+		const uint64_t dots = ByteOrder::GetLE(&data[at + 29], 4);
+		at += sampleFixed;
+		if (at + dots * 16 > data.size())
+			break;
+		for (uint64_t d = 0; d < dots; d++, at += 16)
+			s.dots.push_back({ Vec2({ GetF32(&data[at]), GetF32(&data[at + 4]) }), Vec2({ GetF32(&data[at + 8]), GetF32(&data[at + 12]) }) });
+		out.samples.push_back(std::move(s));
+	}
+	if (out.samples.size() != sampleCount) {
+		GAME_ERROR(std::format("Golden trajectory {} is cut short", fName));
+		return false;
+	}
+	return true;
+}
+
+GoldenResult Golden::Compare(const GoldenTrajectory& golden, const GoldenTrajectory& run, const GoldenTolerance& tol)
+{
+	GoldenResult res;
+	auto fail = [&res](uint64_t tick, const std::string& reason) {
+		if (!res.passed)
+			return;
+		res.passed = false;
+		res.failTick = tick;
+		res.reason = reason;
+	};
+
+	if (golden.samples.size() != run.samples.size())
+		fail(0, std::format("{} samples instead of {}", run.samples.size(), golden.samples.size()));
+
+	const size_t count = std::min(golden.samples.size(), run.samples.size());
+	for (size_t i = 0; i < count; i++) {
+		const GoldenSample& g = golden.samples[i];
+		const GoldenSample& r = run.samples[i];
+		if (g.tick != r.tick) {
+			fail(g.tick, std::format("sampled at tick {} instead of {}", r.tick, g.tick));
+			break;
+		}
+		if (g.dots.size() != r.dots.size()) {
+			fail(g.tick, std::format("{} dots instead of {}", r.dots.size(), g.dots.size()));
+			break;
+		}
+
+		float posErr = std::max(std::abs(g.leftBar.yPos - r.leftBar.yPos), std::abs(g.rightBar.yPos - r.rightBar.yPos));
+		float velErr = 0.0f;
+		for (size_t d = 0; d < g.dots.size(); d++) {
+			posErr = std::max(posErr, (g.dots[d].pos - r.dots[d].pos).length());
+			velErr = std::max(velErr, (g.dots[d].vel - r.dots[d].vel).length());
+		}
+		// Bar speeds are in pixels per second, compared as positions
+		posErr = std::max({ posErr, std::abs(g.leftBar.yVel - r.leftBar.yVel) * 1e-3f, std::abs(g.rightBar.yVel - r.rightBar.yVel) * 1e-3f });
+		res.maxPosErr = std::max(res.maxPosErr, posErr);
+		res.maxVelErr = std::max(res.maxVelErr, velErr);
+
+		if (g.barHits != r.barHits || g.events != r.events)
+			fail(g.tick, std::format("{} bar hits and events {:#x} instead of {} and {:#x}", r.barHits, r.events, g.barHits, g.events));
+		else if (posErr > tol.pos)
+			fail(g.tick, std::format("position off by {:.3g}", posErr));
+		else if (velErr > tol.vel)
+			fail(g.tick, std::format("velocity off by {:.3g}", velErr));
+	}
+	return res;
+}
+
+bool Golden::WriteGeneratedReplay(const std::string& fName, uint64_t seed, Integrator integrator, uint16_t tickRate, uint64_t ticks)
+{
+	// Same combinations a player can make, including single player mode switches
+	constexpr uint16_t combos[] = {
+		0, In_W, In_S, In_Up, In_Down, In_W | In_Up, In_W | In_Down, In_S | In_Up, In_S | In_Down, In_1, In_2
+	};
+
+	ReplayWriter writer;
+	if (!writer.Open(fName, { tickRate, integrator, seed }))
+		return false;
+
+	Rng rng = RngService(seed).Stream(2);
+	InputFrame frame;
+	frame.arenaW = 1600;
+	frame.arenaH = 900;
+	uint64_t holdLeft = 0;
+	for (uint64_t t = 0; t < ticks; t++) {
+		if (holdLeft == 0) {
+			frame.keys = combos[rng.Next() % std::size(combos)];
+			frame.mouseX = static_cast<int16_t>(rng.Next() % frame.arenaW);
+			frame.mouseY = static_cast<int16_t>(rng.Next() % frame.arenaH);
+			holdLeft = 1 + rng.Next() % 120;
+		}
+		holdLeft--;
+		if (t == ticks / 2) {
+			frame.arenaW = 1280;
+			frame.arenaH = 720;
+		}
+		writer.Record(frame);
+	}
+	writer.Close();
+	return true;
+}
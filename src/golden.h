@@ -0,0 +1,74 @@
+#pragma once
+
+#include "gameState.h"
+#include "integrator.h"
+
+class JobSystem;
+
+/**
+ * Golden state regression cases. A case is a replay (seed, integrator, tick rate and the input of every tick)
+ * and a trajectory file with the states that playing it gave when the case was written.
+ * Trajectory layout (little endian): magic "HPGD", u16 version, u16 header size, u32 dot count, u32 sample interval,
+ * u64 ticks, f32 arena width and height, u8 jobs, u32 sample count, then per sample: u64 tick, u32 bar hits since
+ * the previous sample, u8 event flags, f32 left and right bar position and speed, u32 dot count and f32 pos and vel per dot.
+ */
+struct GoldenHeader
+{
+	uint32_t dotCount = 1;		// Extra dots are spawned from the seed, a lone dot is served again after a miss or capture
+	uint32_t sampleEvery = 1;	// Ticks between samples, events are summed in between
+	uint64_t ticks = 0;			// 0 plays the whole replay
+	float arenaW = 1600.f, arenaH = 900.f;	// Arena at the start, the input frames resize it
+	bool useJobs = false;		// Steps on the job system, the result must not change
+};
+
+enum GoldenEventFlags : uint8_t
+{
+	Ge_LeftMiss = 1 << 0,
+	Ge_RightMiss = 1 << 1,
+	Ge_Captured = 1 << 2
+};
+
+struct GoldenSample
+{
+	uint64_t tick = 0;
+	uint32_t barHits = 0;
+	uint8_t events = 0;		// GoldenEventFlags
+	BarState leftBar{}, rightBar{};
+	std::vector<DotState> dots;
+};
+
+struct GoldenTrajectory
+{
+	GoldenHeader header;
+	std::vector<GoldenSample> samples;
+};
+
+/** Largest differences allowed to the golden states, positions in pixels and speeds in m/s */
+struct GoldenTolerance
+{
+	float pos = 1e-3f;
+	float vel = 1e-5f;
+};
+
+struct GoldenResult
+{
+	bool passed = true;
+	uint64_t failTick = 0;	// Sample where the first difference over the tolerances was seen
+	std::string reason;
+	float maxPosErr = 0.0f;
+	float maxVelErr = 0.0f;
+};
+
+namespace Golden {
+	/** Plays the replay from its seed and samples the states */
+	bool Run(const std::string& replayFile, const GoldenHeader& header, JobSystem* jobs, GoldenTrajectory& out);
+
+	bool Write(const std::string& fName, const GoldenTrajectory& trajectory);
+	bool Read(const std::string& fName, GoldenTrajectory& out);
+
+	/** Checks every sample, errors are tracked over the whole run even after the first failure */
+	GoldenResult Compare(const GoldenTrajectory& golden, const GoldenTrajectory& run, const GoldenTolerance& tol);
+
+	/** Replay of generated input from the seed: key combinations held for random lengths, mouse moves and a resize half way */
+	bool WriteGeneratedReplay(const std::string& fName, uint64_t seed, Integrator integrator, uint16_t tickRate, uint64_t ticks);
+}
@@ -0,0 +1,561 @@
+// Headless batch runner, simulates independent matches between two bots on every core and writes aggregate statistics
+#include "simulation.h"
+#include "golden.h"
+#include "replay.h"
+#include "Net/netPeer.h"
+#include "Net/spectator.h"
+#include "Utils/jobSystem.h"
+#include "Utils/logger.h"
+#include "Utils/random.h"
+
+#include <cmath>
+#include <filesystem>
+#include <stdexcept>
+
+#define ARENAWIDTH 1600
+#define ARENAHEIGHT 900
+
+struct RunnerConfig
+{
+	uint64_t matches = 100000;
+	uint64_t seed = RngService::SeedFromClock();
+	int32_t threads = -1;
+	float dt = 1.f / 240.f;
+	float maxMatchSecs = 120.f;
+	Integrator integrator = Int_SemiImplicitEuler;
+	std::string outFile = "sim_stats.txt";
+	float netplaySecs = 0.f;	// Plays a networked match over loopback instead when set
+	NetOptions net;
+	uint32_t spectators = 0;	// Load tests the spectator server with this many clients instead when set
+	float spectateSecs = 10.f;
+	std::string golden;			// "check" or "write" runs the golden state regression cases instead
+	std::string goldenDir = HYPERPONG_GOLDEN_DIR;
+	std::string goldenAdd;		// Replay to make a new golden case from
+	GoldenTolerance goldenTol;
+};
+
+struct MatchStats
+{
+	static constexpr size_t s_rallyBins = 64;		// The last bin collects everything longer
+	static constexpr size_t s_speedBins = 40;
+	static constexpr float s_speedBinWidth = 0.25f;	// m/s
+
+	uint64_t matches = 0;
+	uint64_t captures = 0;
+	uint64_t leftMisses = 0;
+	uint64_t rightMisses = 0;
+	uint64_t timeouts = 0;
+	uint64_t totalHits = 0;
+	uint64_t ticks = 0;
+	float maxSpeed = 0.0f;
+	std::array<uint64_t, s_rallyBins> rallyHist{};
+	std::array<uint64_t, s_speedBins> speedHist{};	// Sampled every tick
+
+	void Merge(const MatchStats& other) {
+		matches += other.matches;
+		captures += other.captures;
+		leftMisses += other.leftMisses;
+		rightMisses += other.rightMisses;
+		timeouts += other.timeouts;
+		totalHits += other.totalHits;
+		ticks += other.ticks;
+		maxSpeed = std::max(maxSpeed, other.maxSpeed);
+		for (size_t i = 0; i < s_rallyBins; i++)
+			rallyHist[i] += other.rallyHist[i];
+		for (size_t i = 0; i < s_speedBins; i++)
+			speedHist[i] += other.speedHist[i];
+	}
+};
+
+/** Chases the dot when it is coming towards the bar, aiming at a point on the bar that changes after every hit */
+static BarControl AutoPlay(const Bar& bar, const Projectile& dot, bool isLeft, float aimOffset)
+{
+	const bool incoming = isLeft ? dot.GetVel()[0] < 0.0f : dot.GetVel()[0] > 0.0f;
+	const float target = incoming ? dot.GetPos()[1] + aimOffset : ARENAHEIGHT * 0.5f;
+	const float diff = target - bar.GetY();
+	if (diff > Bar::s_size)
+		return Ctrl_Up;
+	if (diff < -Bar::s_size)
+		return Ctrl_Down;
+	return Ctrl_Brake;
+}
+
+static void RunMatch(const RunnerConfig& cfg, Rng rng, MatchStats& stats)
+{
+	constexpr float aimRange = 1.2f * Bar::s_height;
+
+	Simulation sim(static_cast<float>(ARENAWIDTH), static_cast<float>(ARENAHEIGHT), rng.Next(), cfg.integrator);
+	sim.Serve();
+
+	const uint64_t maxTicks = static_cast<uint64_t>(cfg.maxMatchSecs / cfg.dt);
+	float leftAim = rng.UniformF(-aimRange, aimRange), rightAim = rng.UniformF(-aimRange, aimRange);
+	uint64_t hits = 0;
+	SimEvents ev;
+	while (sim.GetTick() < maxTicks) {
+		const Projectile& dot = sim.GetDots().front();
+		TickInput input;
+		input.left = AutoPlay(sim.GetLeftBar(), dot, true, leftAim);
+		input.right = AutoPlay(sim.GetRightBar(), dot, false, rightAim);
+
+		ev = sim.Step(input, cfg.dt);
+		if (ev.barHits > 0) {
+			hits += ev.barHits;
+			leftAim = rng.UniformF(-aimRange, aimRange);
+			rightAim = rng.UniformF(-aimRange, aimRange);
+		}
+
+		const float speed = sim.GetDots().front().GetVel().length();
+		stats.maxSpeed = std::max(stats.maxSpeed, speed);
+		stats.speedHist[std::min(static_cast<size_t>(speed / MatchStats::s_speedBinWidth), MatchStats::s_speedBins - 1)]++;
+
+		if (ev.captured || ev.leftMiss || ev.rightMiss)
+			break;
+	}
+
+	stats.matches++;
+	stats.ticks += sim.GetTick();
+	stats.totalHits += hits;
+	stats.rallyHist[std::min<size_t>(hits, MatchStats::s_rallyBins - 1)]++;
+	if (ev.captured)
+		stats.captures++;
+	else if (ev.leftMiss)
+		stats.leftMisses++;
+	else if (ev.rightMiss)
+		stats.rightMisses++;
+	else
+		stats.timeouts++;
+}
+
+static bool WriteStats(const RunnerConfig& cfg, const MatchStats& stats, double wallSecs)
+{
+	std::ofstream file(cfg.outFile);
+	if (!file) {
+		GAME_ERROR(std::format("Could not open file {}", cfg.outFile));
+		return false;
+	}
+
+	const double n = static_cast<double>(std::max<uint64_t>(stats.matches, 1));
+	file << std::format("matches,{}\n", stats.matches);
+	file << std::format("seed,{}\n", cfg.seed);
+	file << std::format("integrator,{}\n", Integration::GetName(cfg.integrator));
+	file << std::format("dt,{}\n", cfg.dt);
+	file << std::format("wall_secs,{:.3f}\n", wallSecs);
+	file << std::format("capture_rate,{:.6f}\n", stats.captures / n);
+	file << std::format("left_miss_rate,{:.6f}\n", stats.leftMisses / n);
+	file << std::format("right_miss_rate,{:.6f}\n", stats.rightMisses / n);
+	file << std::format("timeout_rate,{:.6f}\n", stats.timeouts / n);
+	file << std::format("mean_rally,{:.4f}\n", stats.totalHits / n);
+	file << std::format("mean_match_secs,{:.4f}\n", stats.ticks * cfg.dt / n);
+	file << std::format("max_speed,{:.4f}\n", stats.maxSpeed);
+
+	file << "\nrally_length,count\n";
+	for (size_t i = 0; i < MatchStats::s_rallyBins; i++)
+		file << std::format("{}{},{}\n", i, i == MatchStats::s_rallyBins - 1 ? "+" : "", stats.rallyHist[i]);
+
+	file << "\nspeed_from,count\n";
+	for (size_t i = 0; i < MatchStats::s_speedBins; i++)
+		file << std::format("{:.2f},{}\n", i * MatchStats::s_speedBinWidth, stats.speedHist[i]);
+
+	return true;
+}
+
+/**
+ * Two bots play over loopback UDP through the artificial link conditions, both sessions in this thread on a virtual clock.
+ * Every confirmed tick is checked to hash to the same state on both ends.
+ */
+static int RunNetplay(const RunnerConfig& cfg)
+{
+	NetOptions hostOpt = cfg.net, clientOpt = cfg.net;
+	hostOpt.isHost = true;
+	hostOpt.port = 0;
+	clientOpt.isHost = false;
+	NetPeer host(hostOpt, cfg.seed, static_cast<float>(ARENAWIDTH), static_cast<float>(ARENAHEIGHT), cfg.integrator, cfg.dt);
+	if (!host.Open())
+		return -1;
+	clientOpt.peerHost = "127.0.0.1";
+	clientOpt.peerPort = host.GetLocalPort();
+	// The client's seed gets replaced by the host's in the handshake
+	NetPeer client(clientOpt, cfg.seed + 1, static_cast<float>(ARENAWIDTH), static_cast<float>(ARENAHEIGHT), cfg.integrator, cfg.dt);
+	if (!client.Open())
+		return -1;
+
+	const RngService rngs(cfg.seed);
+	Rng aimRng[2] = { rngs.Stream(0), rngs.Stream(1) };
+	float aim[2] = { 0.0f, 0.0f };
+	NetPeer* peers[2] = { &host, &client };
+
+	const uint64_t ticks = static_cast<uint64_t>(cfg.netplaySecs / cfg.dt);
+	uint64_t nextCheck = 0, mismatches = 0;
+	auto start = std::chrono::steady_clock::now();
+	// Stalls are expected, the limit only guards against a session that never starts
+	for (uint64_t step = 0; step < 4 * ticks + 1000 && (host.GetSession().GetTick() < ticks || client.GetSession().GetTick() < ticks); step++) {
+		const double now = step * static_cast<double>(cfg.dt);
+		for (int p = 0; p < 2; p++) {
+			const RollbackSession& session = peers[p]->GetSession();
+			BarControl ctrl = Ctrl_Brake;
+			if (session.IsRunning()) {
+				// Each bot acts on its own, possibly mispredicted, view of the game
+				const Simulation& sim = session.GetSim();
+				if (session.GetTick() % 120 == 0)
+					aim[p] = aimRng[p].UniformF(-1.2f * Bar::s_height, 1.2f * Bar::s_height);
+				ctrl = AutoPlay(p == 0 ? sim.GetLeftBar() : sim.GetRightBar(), sim.GetDots().front(), p == 0, aim[p]);
+			}
+			peers[p]->Tick(ctrl, now);
+		}
+
+		uint64_t hostSum, clientSum;
+		while (host.GetSession().GetConfirmedChecksum(nextCheck, hostSum) && client.GetSession().GetConfirmedChecksum(nextCheck, clientSum)) {
+			if (hostSum != clientSum && mismatches++ == 0)
+				GAME_ERROR(std::format("Desync at tick {}", nextCheck));
+			nextCheck++;
+		}
+	}
+	const double wallSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	GAME_INFO(std::format("Netplay over loopback with {:.0f}ms latency, {:.0f}ms jitter, {:.1f}% loss and {} ticks input delay, seed {}",
+		cfg.net.link.latencyMs, cfg.net.link.jitterMs, cfg.net.link.lossRate * 100.f, cfg.net.inputDelay, cfg.seed));
+	for (int p = 0; p < 2; p++) {
+		const RollbackStats& st = peers[p]->GetSession().GetStats();
+		GAME_INFO(std::format("{}: {} ticks, {} rollbacks ({:.1f} ticks on average, max {}), {} stalled ticks, {} time sync waits, {} packets dropped",
+			p == 0 ? "Host" : "Client", peers[p]->GetSession().GetTick(), st.rollbacks,
+			st.resimulatedTicks / static_cast<double>(std::max<uint64_t>(st.rollbacks, 1)), st.maxRollback, st.stalledTicks, st.syncWaits, peers[p]->GetLink().GetDropped()));
+	}
+	GAME_INFO(std::format("Compared {} confirmed ticks in {:.2f}s, {} mismatches", nextCheck, wallSecs, mismatches));
+
+	if (nextCheck == 0 || mismatches > 0)
+		return -1;
+	return 0;
+}
+
+/**
+ * Spectator server load test over loopback. A bot match runs in real time on this thread and publishes every tick,
+ * while another thread reads all the clients through one poller.
+ */
+static int RunSpectatorTest(const RunnerConfig& cfg)
+{
+	constexpr uint32_t ticksPerSend = 4;
+
+	SpectatorServer server;
+	NetAddress serverAddr;
+	if (!server.Start(0, ticksPerSend) || !UdpSocket::Resolve("127.0.0.1", server.GetPort(), serverAddr))
+		return -1;
+
+	Poller poller;
+	std::vector<std::unique_ptr<SpectatorClient>> clients(cfg.spectators);
+	for (uint32_t i = 0; i < cfg.spectators; i++) {
+		clients[i] = std::make_unique<SpectatorClient>();
+		if (!clients[i]->Open(serverAddr, cfg.dt) || !poller.Add(clients[i]->GetHandle(), i))
+			return -1;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	auto secsSinceStart = [start]() { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+	std::atomic<bool> done = false;
+	std::thread reader([&]() {
+		std::vector<uint64_t> ready;
+		double lastAll = 0.0;
+		while (!done) {
+			poller.Wait(10, ready);
+			const double now = secsSinceStart();
+			for (uint64_t i : ready)
+				clients[i]->Poll(now);
+			// Hellos are repeated until the first state arrives
+			if (now - lastAll > 0.1) {
+				for (auto& c : clients)
+					c->Poll(now);
+				lastAll = now;
+			}
+		}
+	});
+
+	Simulation sim(static_cast<float>(ARENAWIDTH), static_cast<float>(ARENAHEIGHT), cfg.seed, cfg.integrator);
+	sim.Serve();
+	const uint64_t ticks = static_cast<uint64_t>(cfg.spectateSecs / cfg.dt);
+	const auto tickDur = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(cfg.dt));
+	auto nextTick = start;
+	double maxPublishUs = 0.0, totalPublishUs = 0.0;
+	for (uint64_t t = 0; t < ticks; t++) {
+		TickInput input;
+		input.left = AutoPlay(sim.GetLeftBar(), sim.GetDots().front(), true, 0.0f);
+		input.right = AutoPlay(sim.GetRightBar(), sim.GetDots().front(), false, 0.0f);
+		const SimEvents ev = sim.Step(input, cfg.dt);
+		if (ev.captured || ev.leftMiss || ev.rightMiss)
+			sim.Serve();
+
+		// All the game thread pays for the spectators
+		const auto publishStart = std::chrono::steady_clock::now();
+		server.Publish(sim);
+		const double publishUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - publishStart).count();
+		maxPublishUs = std::max(maxPublishUs, publishUs);
+		totalPublishUs += publishUs;
+
+		nextTick += tickDur;
+		std::this_thread::sleep_until(nextTick);
+	}
+	const double wallSecs = secsSinceStart();
+	done = true;
+	reader.join();
+
+	uint64_t minReceived = UINT64_MAX, totalReceived = 0, decodeFailures = 0, sampled = 0;
+	GameSnapshot snap;
+	for (auto& c : clients) {
+		minReceived = std::min(minReceived, c->GetReceived());
+		totalReceived += c->GetReceived();
+		decodeFailures += c->GetDecodeFailures();
+		sampled += c->Sample(wallSecs, snap);
+	}
+	const uint32_t connected = server.GetClientCount();
+	for (auto& c : clients)
+		c->Close();
+	server.Stop();
+
+	const double expected = ticks / static_cast<double>(ticksPerSend);
+	GAME_INFO(std::format("{} spectators for {:.1f}s, {} connected at the end, {} could draw", cfg.spectators, wallSecs, connected, sampled));
+	GAME_INFO(std::format("States received per client: min {}, mean {:.1f} of {:.0f} sent, {} decode failures",
+		minReceived, totalReceived / static_cast<double>(std::max<uint32_t>(cfg.spectators, 1)), expected, decodeFailures));
+	GAME_INFO(std::format("Server sent {} packets, {:.1f} bytes on average, {:.2f}% full states, {} send failures",
+		server.GetPacketsSent(), server.GetBytesSent() / static_cast<double>(std::max<uint64_t>(server.GetPacketsSent(), 1)),
+		100.0 * server.GetFullSends() / std::max<uint64_t>(server.GetPacketsSent(), 1), server.GetSendFailures()));
+	GAME_INFO(std::format("Publish on the game thread took {:.2f}us on average, {:.1f}us at most", totalPublishUs / std::max<uint64_t>(ticks, 1), maxPublishUs));
+
+	return minReceived > 0 && decodeFailures == 0 ? 0 : -1;
+}
+
+/** Built in golden cases, the replays are generated from the seeds when the cases are written */
+struct GoldenCase
+{
+	const char* name;
+	uint64_t seed;
+	Integrator integrator;
+	GoldenHeader header;
+};
+
+static const GoldenCase s_goldenCases[] = {
+	{ "euler", 1, Int_SemiImplicitEuler, { 1, 8, 2400 } },
+	{ "verlet", 2, Int_VelocityVerlet, { 1, 8, 2400 } },
+	{ "rk4", 3, Int_RK4, { 1, 8, 2400 } },
+	{ "swarm", 4, Int_SemiImplicitEuler, { 512, 120, 960, 1600.f, 900.f, true } }
+};
+
+static int WriteGolden(const RunnerConfig& cfg, JobSystem& jobs)
+{
+	std::filesystem::create_directories(cfg.goldenDir);
+
+	std::vector<std::pair<std::string, GoldenHeader>> cases;
+	if (!cfg.goldenAdd.empty()) {
+		// A recorded game, played to its end
+		const std::string name = std::filesystem::path(cfg.goldenAdd).stem().string();
+		// A replay that can't be played isn't added, it would fail every later check
+		ReplayReader replay;
+		if (!replay.Open(cfg.goldenAdd))
+			return -1;
+		std::error_code err;
+		std::filesystem::copy_file(cfg.goldenAdd, std::format("{}/{}.hprp", cfg.goldenDir, name), std::filesystem::copy_options::overwrite_existing, err);
+		if (err) {
+			GAME_ERROR(std::format("Could not copy {} to {}: {}", cfg.goldenAdd, cfg.goldenDir, err.message()));
+			return -1;
+		}
+		cases.emplace_back(name, GoldenHeader{ 1, 8, 0 });
+	} else {
+		for (const GoldenCase& c : s_goldenCases) {
+			if (!Golden::WriteGeneratedReplay(std::format("{}/{}.hprp", cfg.goldenDir, c.name), c.seed, c.integrator, 240, c.header.ticks))
+				return -1;
+			cases.emplace_back(c.name, c.header);
+		}
+	}
+
+	for (const auto& [name, header] : cases) {
+		GoldenTrajectory trajectory;
+		if (!Golden::Run(std::format("{}/{}.hprp", cfg.goldenDir, name), header, &jobs, trajectory) ||
+			!Golden::Write(std::format("{}/{}.hpgd", cfg.goldenDir, name), trajectory))
+			return -1;
+		GAME_INFO(std::format("Golden case {}: {} ticks, {} samples", name, trajectory.header.ticks, trajectory.samples.size()));
+	}
+	return 0;
+}
+
+/** Plays every case in the directory and compares to its stored states, fails if any of them is off */
+static int CheckGolden(const RunnerConfig& cfg, JobSystem& jobs)
+{
+	std::vector<std::filesystem::path> files;
+	std::error_code err;
+	for (const auto& entry : std::filesystem::directory_iterator(cfg.goldenDir, err)) {
+		if (entry.path().extension() == ".hpgd")
+			files.push_back(entry.path());
+	}
+	if (files.empty()) {
+		GAME_ERROR(std::format("No golden cases in {}", cfg.goldenDir));
+		return -1;
+	}
+	std::sort(files.begin(), files.end());
+
+	uint32_t failed = 0;
+	for (const std::filesystem::path& file : files) {
+		GoldenTrajectory golden, run;
+		std::filesystem::path replay = file;
+		replay.replace_extension(".hprp");
+		if (!Golden::Read(file.string(), golden) || !Golden::Run(replay.string(), golden.header, &jobs, run)) {
+			failed++;
+			continue;
+		}
+		const GoldenResult res = Golden::Compare(golden, run, cfg.goldenTol);
+		if (res.passed) {
+			GAME_INFO(std::format("PASS {}: {} ticks, max position error {:.3g}, max velocity error {:.3g}",
+				file.stem().string(), golden.header.ticks, res.maxPosErr, res.maxVelErr));
+		} else {
+			GAME_ERROR(std::format("FAIL {} at tick {}: {}, max position error {:.3g}, max velocity error {:.3g}",
+				file.stem().string(), res.failTick, res.reason, res.maxPosErr, res.maxVelErr));
+			failed++;
+		}
+	}
+	GAME_INFO(std::format("{} of {} golden cases passed", files.size() - failed, files.size()));
+	return failed == 0 ? 0 : -1;
+}
+
+// Durations and the time step, zero, negative or infinite ones would make no sense as tick counts
+static float ParseSecs(const std::string& val)
+{
+	const float secs = std::stof(val);
+	if (!(secs > 0.f) || !std::isfinite(secs))
+		throw std::out_of_range("Has to be a positive number of seconds");
+	return secs;
+}
+
+static bool ParseArgs(int argc, char** argv, RunnerConfig& cfg)
+{
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (i + 1 >= argc) {
+			GAME_ERROR(std::format("Missing value for {}", arg));
+			return false;
+		}
+		const std::string val = argv[++i];
+		// The sto* functions throw on text that isn't a number or doesn't fit
+		try {
+			if (arg == "--matches") {
+				cfg.matches = std::stoull(val);
+			} else if (arg == "--seed") {
+				cfg.seed = std::stoull(val);
+			} else if (arg == "--threads") {
+				cfg.threads = std::stoi(val);
+			} else if (arg == "--dt") {
+				cfg.dt = ParseSecs(val);
+			} else if (arg == "--max-secs") {
+				cfg.maxMatchSecs = ParseSecs(val);
+			} else if (arg == "--out") {
+				cfg.outFile = val;
+			} else if (arg == "--netplay") {
+				cfg.netplaySecs = ParseSecs(val);
+			} else if (arg == "--latency") {
+				cfg.net.link.latencyMs = std::stof(val);
+			} else if (arg == "--jitter") {
+				cfg.net.link.jitterMs = std::stof(val);
+			} else if (arg == "--loss") {
+				cfg.net.link.lossRate = std::stof(val);
+			} else if (arg == "--spectators") {
+				cfg.spectators = static_cast<uint32_t>(std::stoul(val));
+			} else if (arg == "--spectate-secs") {
+				cfg.spectateSecs = ParseSecs(val);
+			} else if (arg == "--golden") {
+				if (val != "check" && val != "write") {
+					GAME_ERROR(std::format("Unknown golden mode {}", val));
+					return false;
+				}
+				cfg.golden = val;
+			} else if (arg == "--golden-dir") {
+				cfg.goldenDir = val;
+			} else if (arg == "--golden-add") {
+				cfg.golden = "write";
+				cfg.goldenAdd = val;
+			} else if (arg == "--pos-tol") {
+				cfg.goldenTol.pos = std::stof(val);
+			} else if (arg == "--vel-tol") {
+				cfg.goldenTol.vel = std::stof(val);
+			} else if (arg == "--input-delay") {
+				cfg.net.inputDelay = static_cast<uint32_t>(std::stoul(val));
+			} else if (arg == "--integrator") {
+				bool found = false;
+				for (int t = 0; t < Integrator_COUNT; t++) {
+					if (val == Integration::GetName(static_cast<Integrator>(t))) {
+						cfg.integrator = static_cast<Integrator>(t);
+						found = true;
+					}
+				}
+				if (!found) {
+					GAME_ERROR(std::format("Unknown integrator {}", val));
+					return false;
+				}
+			} else {
+				GAME_ERROR(std::format("Unknown argument {}", arg));
+				return false;
+			}
+		} catch (const std::logic_error&) {
+			GAME_ERROR(std::format("Invalid value {} for {}", val, arg));
+			return false;
+		}
+	}
+	if (cfg.spectators > SpectatorServer::s_maxClients) {
+		GAME_ERROR(std::format("The spectator server takes at most {} clients", SpectatorServer::s_maxClients));
+		return false;
+	}
+	for (float secs : { cfg.maxMatchSecs, cfg.netplaySecs, cfg.spectateSecs }) {
+		if (secs / cfg.dt > static_cast<float>(UINT32_MAX)) {
+			GAME_ERROR(std::format("{}s is too many ticks of {}s", secs, cfg.dt));
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	RunnerConfig cfg;
+	if (!ParseArgs(argc, argv, cfg)) {
+		GAME_INFO("Usage: HyperPongSim [--matches N] [--seed N] [--threads N] [--dt secs] [--max-secs secs] [--integrator name] [--out file]");
+		GAME_INFO("   or: HyperPongSim --netplay secs [--latency ms] [--jitter ms] [--loss rate] [--input-delay ticks] [--seed N]");
+		GAME_INFO("   or: HyperPongSim --spectators N [--spectate-secs secs] [--seed N]");
+		GAME_INFO("   or: HyperPongSim --golden check|write [--golden-dir dir] [--pos-tol pixels] [--vel-tol m/s] [--threads N]");
+		GAME_INFO("   or: HyperPongSim --golden-add replay [--golden-dir dir]");
+		return -1;
+	}
+	if (cfg.netplaySecs > 0.f)
+		return RunNetplay(cfg);
+	if (cfg.spectators > 0)
+		return RunSpectatorTest(cfg);
+
+	JobSystem jobs(cfg.threads);
+	if (cfg.golden == "write")
+		return WriteGolden(cfg, jobs);
+	if (cfg.golden == "check")
+		return CheckGolden(cfg, jobs);
+
+	// Every match has its own stream and batches are merged in order, so the result only depends on the seed
+	constexpr uint64_t matchesPerBatch = 256;
+	const uint64_t batchCount = (cfg.matches + matchesPerBatch - 1) / matchesPerBatch;
+	const RngService rngs(cfg.seed);
+	std::vector<MatchStats> batchStats(batchCount);
+
+	auto start = std::chrono::steady_clock::now();
+	jobs.ParallelFor(0, batchCount, 1, [&](size_t first, size_t last) {
+		for (size_t b = first; b < last; b++) {
+			const uint64_t end = std::min(cfg.matches, (b + 1) * matchesPerBatch);
+			for (uint64_t m = b * matchesPerBatch; m < end; m++)
+				RunMatch(cfg, rngs.Stream(m), batchStats[b]);
+		}
+	});
+	const double wallSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	MatchStats total;
+	for (const MatchStats& s : batchStats)
+		total.Merge(s);
+
+	GAME_INFO(std::format("Seed {}", cfg.seed));
+	GAME_INFO(std::format("Simulated {} matches ({} rallies) in {:.2f}s with {} workers, {:.0f} matches/s",
+		total.matches, total.totalHits, wallSecs, jobs.GetWorkerCount(), total.matches / wallSecs));
+	GAME_INFO(std::format("Capture rate {:.4f}, mean rally {:.2f}", total.captures / static_cast<double>(total.matches), total.totalHits / static_cast<double>(total.matches)));
+
+	if (!WriteStats(cfg, total, wallSecs))
+		return -1;
+	GAME_INFO(std::format("Statistics written to {}", cfg.outFile));
+	return 0;
+}
@@ -0,0 +1,72 @@
+#include "integrator.h"
+
+const char* Integration::GetName(Integrator type)
+{
+    switch (type)
+    {
+    case Int_SemiImplicitEuler:
+        return "semi-implicit Euler";
+    case Int_VelocityVerlet:
+        return "velocity Verlet";
+    case Int_RK4:
+        return "RK4";
+    default:
+        return "unknown";
+    }
+}
+
+Vec2 Integration::GravityAcc(const Vec2& pos, const std::vector<GravityWell>& wells)
+{
+    Vec2 acc;
+    for (const GravityWell& well : wells) {
+        Vec2 diff = (well.pos - pos) * (1.f / s_pixPerMeter);  // Normalized to meters
+        float distSq = std::max(diff.lengthSqr(), 1e-4f);       // Add small min value to prevent huge accelerations
+        acc = acc + diff.normalized() * (well.mass / distSq);
+    }
+    return acc;
+}
+
+void Integration::Step(Integrator type, Vec2& pos, Vec2& vel, const std::vector<GravityWell>& wells, float dt)
+{
+    switch (type)
+    {
+    case Int_SemiImplicitEuler: {
+        vel = vel + GravityAcc(pos, wells) * dt;
+        pos = pos + vel * (dt * s_pixPerMeter);
+        break;
+    }
+    case Int_VelocityVerlet: {
+        Vec2 acc0 = GravityAcc(pos, wells);
+        pos = pos + (vel * dt + acc0 * (0.5f * dt * dt)) * s_pixPerMeter;
+        Vec2 acc1 = GravityAcc(pos, wells);
+        vel = vel + (acc0 + acc1) * (0.5f * dt);
+        break;
+    }
+    case Int_RK4: {
+        const float halfDt = 0.5f * dt;
+        Vec2 v1 = vel;
+        Vec2 a1 = GravityAcc(pos, wells);
+        Vec2 v2 = vel + a1 * halfDt;
+        Vec2 a2 = GravityAcc(pos + v1 * (halfDt * s_pixPerMeter), wells);
+        Vec2 v3 = vel + a2 * halfDt;
+        Vec2 a3 = GravityAcc(pos + v2 * (halfDt * s_pixPerMeter), wells);
+        Vec2 v4 = vel + a3 * dt;
+        Vec2 a4 = GravityAcc(pos + v3 * (dt * s_pixPerMeter), wells);
+
+        const float sixthDt = dt / 6.f;
+        pos = pos + (v1 + (v2 + v3) * 2.f + v4) * (sixthDt * s_pixPerMeter);
+        vel = vel + (a1 + (a2 + a3) * 2.f + a4) * sixthDt;
+        break;
+    }
+    default:
+        GAME_ASSERT(false, "Invalid integrator supplied");
+        break;
+    }
+}
+
+Vec2 Integration::QuadraticDrag(const Vec2& vel, float coef, float mass, float dt)
+{
+    // Speed follows 1/v(t) = 1/v0 + (coef / mass) * t and the direction stays the same
+    float speed = vel.length();
+    return vel * (1.f / (1.f + speed * coef * dt / mass));
+}
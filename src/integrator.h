@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Utils/matrix.h"
+#include "gameState.h"
+
+enum Integrator
+{
+	Int_SemiImplicitEuler = 0,
+	Int_VelocityVerlet,
+	Int_RK4,
+	Integrator_COUNT
+};
+
+// Positions are in pixels and velocities in m/s, with the conversion 1 pix = 1 mm
+namespace Integration {
+	constexpr float s_pixPerMeter = 1000.f;
+
+	const char* GetName(Integrator type);
+
+	/** Acceleration (m/s^2) at pos caused by all the wells, summed in order */
+	Vec2 GravityAcc(const Vec2& pos, const std::vector<GravityWell>& wells);
+
+	/** Advances pos and vel by dt under the gravity of the wells */
+	void Step(Integrator type, Vec2& pos, Vec2& vel, const std::vector<GravityWell>& wells, float dt);
+
+	/** Exact solution of dv/dt = -(coef / mass) * |v| * v over dt, so it is stable with any step size */
+	Vec2 QuadraticDrag(const Vec2& vel, float coef, float mass, float dt);
+}
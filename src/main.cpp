@@ -1,6 +1,130 @@
 #include "game.h"
+#include "Utils/logger.h"
+#include "Utils/random.h"
 
-int main(void) {
-    Game game;
+#include <stdexcept>
+
+static uint16_t ParsePort(const std::string& str)
+{
+    const unsigned long port = std::stoul(str);
+    if (port > UINT16_MAX)
+        throw std::out_of_range("Port out of range");
+    return static_cast<uint16_t>(port);
+}
+
+// host:port
+static void SplitAddress(const std::string& addr, std::string& host, uint16_t& port)
+{
+    const size_t colon = addr.rfind(':');
+    host = addr.substr(0, colon);
+    port = colon == std::string::npos ? 0 : ParsePort(addr.substr(colon + 1));
+}
+
+static bool ParseArgs(int argc, char** argv, GameOptions& options)
+{
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            GAME_ERROR(std::format("Missing value for {}", arg));
+            return false;
+        }
+        const std::string val = argv[++i];
+        // The sto* functions throw on text that isn't a number or doesn't fit
+        try {
+            if (arg == "--seed")
+                options.seed = std::stoull(val);
+            else if (arg == "--record")
+                options.recordFile = val;
+            else if (arg == "--play")
+                options.playFile = val;
+            else if (arg == "--host") {
+                options.isOnline = true;
+                options.net.isHost = true;
+                options.net.port = ParsePort(val);
+            }
+            else if (arg == "--connect") {
+                options.isOnline = true;
+                options.net.isHost = false;
+                SplitAddress(val, options.net.peerHost, options.net.peerPort);
+            }
+            else if (arg == "--broadcast")
+                options.broadcastPort = ParsePort(val);
+            else if (arg == "--pacing") {
+                bool found = false;
+                for (int m = 0; m < PacingMode_COUNT; m++) {
+                    if (FramePacer::GetName(static_cast<PacingMode>(m)) == val) {
+                        options.pacing = static_cast<PacingMode>(m);
+                        found = true;
+                    }
+                }
+                if (!found) {
+                    GAME_ERROR(std::format("Unknown pacing mode {}", val));
+                    return false;
+                }
+            }
+            else if (arg == "--fps-cap") {
+                options.pacing = Pace_Capped;
+                options.fpsCap = std::stof(val);
+            }
+            else if (arg == "--spectate")
+                SplitAddress(val, options.spectateHost, options.spectatePort);
+            else if (arg == "--shader-dir")
+                options.shaders.overrideDir = val;
+            else if (arg == "--shader-cache") {
+                // A directory, or off
+                options.shaders.cacheDir = val;
+                options.shaders.useCache = options.shaders.cacheDir != "off";
+            }
+            else if (arg == "--background") {
+                bool found = false;
+                for (int q = 0; q < BackgroundQuality_COUNT; q++) {
+                    if (Renderer::GetQualityName(static_cast<BackgroundQuality>(q)) == val) {
+                        options.background = static_cast<BackgroundQuality>(q);
+                        found = true;
+                    }
+                }
+                if (!found) {
+                    GAME_ERROR(std::format("Unknown background quality {}", val));
+                    return false;
+                }
+            }
+            else if (arg == "--background-scale")
+                options.backgroundScale = static_cast<uint32_t>(std::stoul(val));
+            else if (arg == "--particles")
+                options.particles = static_cast<uint32_t>(std::stoul(val));
+            else if (arg == "--input-delay")
+                options.net.inputDelay = static_cast<uint32_t>(std::stoul(val));
+            // Artificial network conditions for testing
+            else if (arg == "--latency")
+                options.net.link.latencyMs = std::stof(val);
+            else if (arg == "--jitter")
+                options.net.link.jitterMs = std::stof(val);
+            else if (arg == "--loss")
+                options.net.link.lossRate = std::stof(val);
+            else {
+                GAME_ERROR(std::format("Unknown argument {}", arg));
+                return false;
+            }
+        } catch (const std::logic_error&) {
+            GAME_ERROR(std::format("Invalid value {} for {}", val, arg));
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    GameOptions options;
+    // An explicit seed reproduces a previous game
+    options.seed = RngService::SeedFromClock();
+    if (!ParseArgs(argc, argv, options)) {
+        GAME_INFO("Usage: HyperPong [--seed N] [--record file | --play file] [--pacing mode] [--fps-cap fps]");
+        GAME_INFO("       [--host port | --connect host:port] [--input-delay ticks] [--latency ms] [--jitter ms] [--loss rate]");
+        GAME_INFO("       [--broadcast port | --spectate host:port] [--shader-dir dir] [--shader-cache dir|off]");
+        GAME_INFO("       [--background quality] [--background-scale N] [--particles N]");
+        return -1;
+    }
+
+    Game game(options);
     return game.Run();
-}
\ No newline at end of file
+}
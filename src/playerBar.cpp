@@ -1,8 +1,7 @@
 #include "playerBar.h"
 
-Bar::Bar(Renderer& rend, float wndH, bool isLeft)
-	: m_renderer(rend),
-	m_isLeft(isLeft),
+Bar::Bar(float wndH, bool isLeft)
+	: m_isLeft(isLeft),
 	m_yPos(wndH * 0.5f),
 	m_yVel(0.0f)
 {
@@ -27,18 +26,10 @@ void Bar::Brake(float dt)
 	m_yPos += m_yVel * dt;
 }
 
-float Bar::GetCollisionX() const
+float Bar::GetCollisionX(float wndW) const
 {
 	if (m_isLeft)
 		return s_indent;
 	else
-		return static_cast<float>(m_renderer.GetWindowWidth()) - s_indent;
-}
-
-void Bar::Draw() const
-{
-	float x = m_isLeft ? 2 * s_size : static_cast<float>(m_renderer.GetWindowWidth()) - 2 * s_size;
-	const Vec2 bar1mid({x, m_yPos });
-	const Vec2 barCornOffset({ s_size, s_height });
-	m_renderer.DrawRect(bar1mid - barCornOffset, bar1mid + barCornOffset);
+		return wndW - s_indent;
 }
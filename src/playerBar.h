@@ -1,11 +1,11 @@
 #pragma once
 
-#include "OpenGL/renderer.h"
+#include "gameState.h"
 
 class Bar
 {
 public:
-    Bar(Renderer& rend, float wndH, bool isLeft);
+    Bar(float wndH, bool isLeft);
 
     void Up(float dt);
     void Down(float dt);
@@ -13,17 +13,18 @@ public:
 
     inline float GetY() const { return m_yPos; }
     inline float GetYVel() const { return m_yVel; }
-    float GetCollisionX() const;
-
-    void Draw() const;
+    inline BarState GetState() const { return { m_yPos, m_yVel, m_isLeft }; }
+    inline void SetState(float yPos, float yVel) { m_yPos = yPos; m_yVel = yVel; }
+    float GetCollisionX(float wndW) const;
 
 private:
-    Renderer& m_renderer;
 	bool m_isLeft;
 	float m_yPos;
 	float m_yVel;
 
-    static constexpr float s_size = 10.f;
+public:
+    static constexpr float s_size = 10.f;    // Half width in pixels
+private:
     static constexpr float s_indent = 3 * s_size; // This is where the collisions happens
     static constexpr float s_acc = 6000.f;
     static constexpr float s_maxSpeed = 1200.f;
@@ -1,33 +1,21 @@
 #include "projectile.h"
 
-Projectile::Projectile(Renderer& rend, float wndH)
-	: m_renderer(rend),
-    m_pos(), m_vel()
+Projectile::Projectile(const Vec2& pos, float dir)
+    : m_pos(pos),
+    m_vel({ s_speed * std::cos(dir), s_speed * std::sin(dir) })
 {
-    m_pos = Vec2({ s_rad, wndH * 0.5f });
-    
-    std::mt19937_64 rng(std::chrono::system_clock::now().time_since_epoch().count());
-    std::uniform_real_distribution<> dis(-1.0, 1.0);
-
-    const float dir = static_cast<float>(dis(rng));
-    m_vel = Vec2({ s_speed * std::cos(dir), s_speed * std::sin(dir) });
 }
 
-void Projectile::GravityToPoint(const Vec2& point, float mass, float dt)
+Projectile::Projectile(const DotState& state)
+    : m_pos(state.pos),
+    m_vel(state.vel)
 {
-    Vec2 diff = (point - m_pos) * 0.001f;                // Normalized to meters
-    float distSq = std::max(diff.lengthSqr(), 1e-4f);   // Add small min value to prevent huge accelerations
-    Vec2 acc = diff.normalized() * (mass / distSq);
-    m_vel = m_vel + acc * dt;
 }
 
 void Projectile::ApplyAirRes(float airResCoef, float dt)
 {
-    float speed = m_vel.length();
-    if (speed > 3.f) {
-        float newSp = s_mass / ((s_mass / (speed * airResCoef) + dt) * airResCoef);
-        m_vel = m_vel * (newSp / speed);
-    }
+    if (m_vel.lengthSqr() > 3.f * 3.f)
+        m_vel = Integration::QuadraticDrag(m_vel, airResCoef, s_mass, dt);
 }
 
 void Projectile::CheckYCollision(float wndH)
@@ -38,8 +26,9 @@ void Projectile::CheckYCollision(float wndH)
         m_vel[1] = -std::abs(m_vel[1]);
 }
 
-void Projectile::CheckLeftCollision(float barY, float barH, float barRight, float barYSpeed, float ySpeedTransferCoef)
+bool Projectile::CheckLeftCollision(float barY, float barH, float barRight, float barYSpeed, float ySpeedTransferCoef)
 {
+    const float velX = m_vel[0];
     if (m_pos[0] < barRight + s_rad) {
         // Check the corners
         if (m_pos[1] > barY + barH) {
@@ -72,10 +61,12 @@ void Projectile::CheckLeftCollision(float barY, float barH, float barRight, floa
             m_vel[1] += barYSpeed * ySpeedTransferCoef;
         }
     }
+    return velX < 0.0f && m_vel[0] > 0.0f;
 }
 
-void Projectile::CheckRightCollision(float barY, float barH, float barLeft, float barYSpeed, float ySpeedTransferCoef, bool is2Player, float wndW)
+bool Projectile::CheckRightCollision(float barY, float barH, float barLeft, float barYSpeed, float ySpeedTransferCoef, bool is2Player, float wndW)
 {
+    const float velX = m_vel[0];
     if (is2Player && m_pos[0] > barLeft - s_rad) {
         // Collisions on the right
         // Check the corners
@@ -111,16 +102,15 @@ void Projectile::CheckRightCollision(float barY, float barH, float barLeft, floa
     } else if (m_pos[0] >= wndW - s_rad) {
         // Single player game
         m_vel[0] = -std::abs(m_vel[0]);
+        return false;
     }
+    return velX > 0.0f && m_vel[0] < 0.0f;
 }
 
-void Projectile::Advance(float dt)
+void Projectile::Integrate(const std::vector<GravityWell>& wells, float airResCoef, float dt, Integrator integrator)
 {
-    // Adjust dot position according to velocity (turn the unit from meters to pix)
-    m_pos = m_pos + (m_vel * dt * 1000);
-}
+    Integration::Step(integrator, m_pos, m_vel, wells, dt);
 
-void Projectile::Draw() const
-{
-    m_renderer.DrawRect(m_pos + (-s_rad), m_pos + s_rad, Vec4({m_vel[0] / s_speed, m_vel[1] / s_speed, m_pos[1] / 1000.f, 1.0f}));
+    // Air res at larger speeds to slow the dot down, split from the gravity since it's solved exactly
+    this->ApplyAirRes(airResCoef, dt);
 }
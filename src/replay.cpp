@@ -0,0 +1,229 @@
+#include "replay.h"
+#include "Utils/logger.h"
+#include "Utils/fileIO.h"
+#include "Utils/byteOrder.h"
+
+static constexpr char s_magic[4] = { 'H', 'P', 'R', 'P' };
+static constexpr uint16_t s_version = 1;
+
+enum ReplayMask : uint8_t
+{
+	Rm_Keys = 1 << 0,
+	Rm_MouseX = 1 << 1,
+	Rm_MouseY = 1 << 2,
+	Rm_ArenaW = 1 << 3,
+	Rm_ArenaH = 1 << 4,
+	Rm_End = 1 << 7
+};
+
+static void PutVarint(std::vector<uint8_t>& buf, uint64_t v)
+{
+	while (v >= 0x80) {
+		buf.push_back(static_cast<uint8_t>(v | 0x80));
+		v >>= 7;
+	}
+	buf.push_back(static_cast<uint8_t>(v));
+}
+
+static void PutDelta(std::vector<uint8_t>& buf, int32_t cur, int32_t prev)
+{
+	// Zigzag so that small negative deltas stay small
+	const int32_t d = cur - prev;
+	PutVarint(buf, (static_cast<uint32_t>(d) << 1) ^ static_cast<uint32_t>(d >> 31));
+}
+
+// *** ReplayWriter *** //
+
+ReplayWriter::ReplayWriter()
+	: m_file(), m_buf(), m_written(), m_pending(), m_hold(0), m_ticks(0)
+{
+}
+
+ReplayWriter::~ReplayWriter()
+{
+	this->Close();
+}
+
+bool ReplayWriter::Open(const std::string& fName, const ReplayHeader& header)
+{
+	m_file.open(fName, std::ios::binary | std::ios::trunc);
+	if (!m_file) {
+		GAME_ERROR(std::format("Could not open file {}", fName));
+		return false;
+	}
+	m_buf.clear();
+	for (char c : s_magic)
+		m_buf.push_back(static_cast<uint8_t>(c));
+	ByteOrder::PutLE(m_buf, s_version, 2);
+	ByteOrder::PutLE(m_buf, header.tickRate, 2);
+	ByteOrder::PutLE(m_buf, header.integrator, 1);
+	ByteOrder::PutLE(m_buf, header.seed, 8);
+	m_written = InputFrame();
+	m_hold = 0;
+	m_ticks = 0;
+	return true;
+}
+
+void ReplayWriter::Record(const InputFrame& frame)
+{
+	if (m_ticks > 0 && frame == m_pending) {
+		m_hold++;
+	} else {
+		if (m_ticks > 0)
+			this->WritePending();
+		m_pending = frame;
+		m_hold = 0;
+	}
+	m_ticks++;
+
+	if (m_buf.size() > 4096)
+		this->Flush();
+}
+
+void ReplayWriter::Close()
+{
+	if (!m_file.is_open())
+		return;
+	if (m_ticks > 0)
+		this->WritePending();
+	m_buf.push_back(Rm_End);
+	this->Flush();
+	m_file.close();
+	GAME_INFO(std::format("Replay of {} ticks recorded", m_ticks));
+}
+
+void ReplayWriter::WritePending()
+{
+	const InputFrame& f = m_pending;
+	uint8_t mask = 0;
+	mask |= f.keys != m_written.keys ? Rm_Keys : 0;
+	mask |= f.mouseX != m_written.mouseX ? Rm_MouseX : 0;
+	mask |= f.mouseY != m_written.mouseY ? Rm_MouseY : 0;
+	mask |= f.arenaW != m_written.arenaW ? Rm_ArenaW : 0;
+	mask |= f.arenaH != m_written.arenaH ? Rm_ArenaH : 0;
+
+	m_buf.push_back(mask);
+	if (mask & Rm_Keys)
+		ByteOrder::PutLE(m_buf, f.keys, 2);
+	if (mask & Rm_MouseX)
+		PutDelta(m_buf, f.mouseX, m_written.mouseX);
+	if (mask & Rm_MouseY)
+		PutDelta(m_buf, f.mouseY, m_written.mouseY);
+	if (mask & Rm_ArenaW)
+		PutDelta(m_buf, f.arenaW, m_written.arenaW);
+	if (mask & Rm_ArenaH)
+		PutDelta(m_buf, f.arenaH, m_written.arenaH);
+	PutVarint(m_buf, m_hold);
+
+	m_written = f;
+}
+
+void ReplayWriter::Flush()
+{
+	m_file.write(reinterpret_cast<const char*>(m_buf.data()), m_buf.size());
+	m_buf.clear();
+}
+
+// *** ReplayReader *** //
+
+ReplayReader::ReplayReader()
+	: m_data(), m_offset(0), m_header(), m_cur(), m_hold(0), m_ended(false)
+{
+}
+
+bool ReplayReader::Open(const std::string& fName)
+{
+	if (!FileIO::ReadFile(fName, m_data))
+		return false;
+	constexpr size_t headerSize = sizeof(s_magic) + 2 + 2 + 1 + 8;
+	if (m_data.size() < headerSize) {
+		GAME_ERROR(std::format("Replay {} is too short", fName));
+		m_data.clear();
+		return false;
+	}
+
+	auto le = [this](size_t at, size_t bytes) { return ByteOrder::GetLE(&m_data[at], bytes); };
+	if (memcmp(m_data.data(), s_magic, sizeof(s_magic)) != 0 || le(4, 2) != s_version) {
+		GAME_ERROR(std::format("{} is not a version {} replay", fName, s_version));
+		m_data.clear();
+		return false;
+	}
+	// Checked here so that every caller can step the simulation with what it reads
+	if (le(6, 2) == 0 || le(8, 1) >= Integrator_COUNT) {
+		GAME_ERROR(std::format("Replay {} has no valid tick rate or integrator", fName));
+		m_data.clear();
+		return false;
+	}
+	m_header.tickRate = static_cast<uint16_t>(le(6, 2));
+	m_header.integrator = static_cast<Integrator>(le(8, 1));
+	m_header.seed = le(9, 8);
+
+	m_offset = headerSize;
+	m_cur = InputFrame();
+	m_hold = 0;
+	m_ended = false;
+	return true;
+}
+
+bool ReplayReader::Next(InputFrame& out)
+{
+	if (m_ended)
+		return false;
+	if (m_hold > 0) {
+		m_hold--;
+	} else if (!this->ReadEntry()) {
+		m_ended = true;
+		return false;
+	}
+	out = m_cur;
+	return true;
+}
+
+bool ReplayReader::ReadEntry()
+{
+	bool ok = true;
+	auto varint = [this, &ok]() {
+		uint64_t v = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			if (m_offset >= m_data.size()) {
+				ok = false;
+				return v;
+			}
+			const uint8_t b = m_data[m_offset++];
+			v |= static_cast<uint64_t>(b & 0x7f) << shift;
+			if ((b & 0x80) == 0)
+				break;
+		}
+		return v;
+	};
+	auto delta = [&varint](int32_t prev) {
+		const uint32_t z = static_cast<uint32_t>(varint());
+		return prev + static_cast<int32_t>((z >> 1) ^ (0u - (z & 1)));
+	};
+
+	if (m_offset >= m_data.size())
+		return false;
+	const uint8_t mask = m_data[m_offset++];
+	if (mask & Rm_End)
+		return false;
+
+	if (mask & Rm_Keys) {
+		if (m_offset + 2 > m_data.size())
+			return false;
+		m_cur.keys = static_cast<uint16_t>(ByteOrder::GetLE(&m_data[m_offset], 2));
+		m_offset += 2;
+	}
+	if (mask & Rm_MouseX)
+		m_cur.mouseX = static_cast<int16_t>(delta(m_cur.mouseX));
+	if (mask & Rm_MouseY)
+		m_cur.mouseY = static_cast<int16_t>(delta(m_cur.mouseY));
+	if (mask & Rm_ArenaW)
+		m_cur.arenaW = static_cast<uint16_t>(delta(m_cur.arenaW));
+	if (mask & Rm_ArenaH)
+		m_cur.arenaH = static_cast<uint16_t>(delta(m_cur.arenaH));
+	m_hold = varint();
+
+	if (!ok)
+		GAME_ERROR("Replay ended in the middle of an entry");
+	return ok;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "gameState.h"
+#include "integrator.h"
+
+/**
+ * Replay files hold the seed and the input frame of every tick.
+ * Layout (little endian): magic "HPRP", u16 version, u16 tick rate, u8 integrator, u64 seed, then entries of
+ * [u8 change mask][changed fields][varint hold] where hold is how many more ticks the frame repeats.
+ * Keys are stored as is and the other fields as zigzag varint deltas. A lone end mask finishes the stream.
+ */
+struct ReplayHeader
+{
+	uint16_t tickRate = 0;
+	Integrator integrator = Int_SemiImplicitEuler;
+	uint64_t seed = 0;
+};
+
+class ReplayWriter
+{
+public:
+	ReplayWriter();
+	~ReplayWriter();
+
+	bool Open(const std::string& fName, const ReplayHeader& header);
+	inline bool IsOpen() const { return m_file.is_open(); }
+
+	void Record(const InputFrame& frame);
+	/** Writes the end entry, also done by the destructor */
+	void Close();
+
+private:
+	std::ofstream m_file;
+	std::vector<uint8_t> m_buf;
+	InputFrame m_written;	// Last frame in the file, the deltas are against it
+	InputFrame m_pending;	// Waits until we know how long it's held
+	uint64_t m_hold;
+	uint64_t m_ticks;
+private:
+	void WritePending();
+	void Flush();
+};
+
+class ReplayReader
+{
+public:
+	ReplayReader();
+
+	/** Reads the whole file at once */
+	bool Open(const std::string& fName);
+	inline bool IsOpen() const { return !m_data.empty(); }
+	inline const ReplayHeader& GetHeader() const { return m_header; }
+
+	/** Gives the frame of the next tick, false once the replay has ended */
+	bool Next(InputFrame& out);
+
+private:
+	std::vector<uint8_t> m_data;
+	size_t m_offset;
+	ReplayHeader m_header;
+	InputFrame m_cur;
+	uint64_t m_hold;
+	bool m_ended;
+private:
+	bool ReadEntry();
+};
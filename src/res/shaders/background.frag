@@ -5,61 +5,34 @@ layout(location = 0) out vec4 color;
 in vec3 v_Position;
 
 uniform float u_Time;
-uniform vec2 u_HighlightPos;
 uniform vec2 u_WindDim;
 
-float prf(uvec2 seeds) {
-	uint seed = (seeds.x * 6967u) ^ (seeds.y * 7919u);
-  uint state = seed * 747796405u + 2891336453u;
-  uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
-  return float((word >> 22u) ^ word) / float(4294967295u);
-}
+#include "noise.glsl"
+#include "highlight.glsl"
 
-vec2 prGrad(uvec2 seeds) {
-	float angle = prf(seeds) * 2 * 3.14159265359;
-	return vec2(cos(angle), sin(angle));
-}
+#ifdef NOISE_TEXTURE
+// Tileable noise from NoiseTexture, the lattice repeats every u_NoisePeriod cells
+uniform sampler2D u_Noise;
+uniform float u_NoisePeriod;
 
-float dottedWithGrad(vec2 icoord, vec2 coord) {
-	vec2 grad = prGrad(floatBitsToUint(icoord));
-	return dot(grad, coord - icoord);
+float noise(vec2 at, float scale) {
+	return texture(u_Noise, at / (scale * u_NoisePeriod)).r;
 }
-
-float perlin(vec2 at, float scale) {
-	vec2 coord = at / scale;
-	vec2 icoord0 = floor(coord);
-	vec2 icoord1 = icoord0 + 1.0;
-
-	float n0 = dottedWithGrad(icoord0, coord);
-	float n1 = dottedWithGrad(vec2(icoord1.x, icoord0.y), coord);
-	
-	float n2 = dottedWithGrad(vec2(icoord0.x, icoord1.y), coord);
-	float n3 = dottedWithGrad(icoord1, coord);
-
-	vec2 left = vec2(n0, n2);
-	vec2 right = vec2(n1, n3);
-
-	vec2 interp_w = smoothstep(icoord0, icoord1, coord);
-
-	vec2 interp_x = (right - left) * interp_w.x + left;
-
-	float interp_y = (interp_x.y - interp_x.x) * interp_w.y + interp_x.x;
-	
-	return (interp_y + 1.0) * 0.5;
+#else
+float noise(vec2 at, float scale) {
+	return perlin(at, scale);
 }
-
-const float coef = 1.0 / sqrt(2 * 3.14159265359);
+#endif
 
 void main() {
   float change = u_Time * 50;
   vec2 pix = (v_Position.xy + 1.0) * u_WindDim * 0.5;
-	vec3 c = vec3(perlin(pix + vec2(change, 0.0), 500.0), perlin(pix + vec2(0.0, change), 400), perlin(pix + change - 0.7, 800));
-	//float d = max(1.0, length(u_HighlightPos - pix) * 0.01);
-	//float d = length(u_HighlightPos - pix) * 0.01;
-  //float dimming = coef * exp(-d*d * 0.5);
-	float d = length(u_HighlightPos - pix);
-  float dimming = 1.0 - smoothstep(0, 250, d) * 0.75;
-	
-	color = vec4(c * max(dimming, 0.1), 1.0);
-	//color = vec4(max(dimming, 0.02), 0.0, 0.0, 1.0);
+	vec3 c = vec3(noise(pix + vec2(change, 0.0), 500.0), noise(pix + vec2(0.0, change), 400), noise(pix + change - 0.7, 800));
+
+#ifdef NO_HIGHLIGHT
+	// Drawn at a lower resolution, backgroundUpscale.frag adds the highlight
+	color = vec4(c, 1.0);
+#else
+	color = vec4(c * highlightDimming(pix), 1.0);
+#endif
 }
\ No newline at end of file
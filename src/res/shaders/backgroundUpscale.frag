@@ -0,0 +1,18 @@
+#version 330 core
+
+// Composites the background drawn at a fraction of the resolution, the highlight is added here at full resolution
+
+layout(location = 0) out vec4 color;
+
+in vec3 v_Position;
+in vec2 v_TexCoord;
+
+uniform sampler2D u_Background;
+uniform vec2 u_WindDim;
+
+#include "highlight.glsl"
+
+void main() {
+	vec2 pix = (v_Position.xy + 1.0) * u_WindDim * 0.5;
+	color = vec4(texture(u_Background, v_TexCoord).rgb * highlightDimming(pix), 1.0);
+}
\ No newline at end of file
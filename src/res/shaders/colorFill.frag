@@ -4,8 +4,12 @@ layout(location = 0) out vec4 color;
 
 in vec3 v_Position;
 
+// Permutations can set the color at compile time instead
+#ifndef FIXED_COLOR
 uniform vec4 u_Color;
+#define FIXED_COLOR u_Color
+#endif
 
 void main() {
-	color = u_Color;
+	color = FIXED_COLOR;
 }
\ No newline at end of file
@@ -0,0 +1,17 @@
+// Dimming around the highlighted point, included with #include "highlight.glsl"
+
+#include "math.glsl"
+
+uniform vec2 u_HighlightPos;
+
+const float coef = 1.0 / sqrt(2 * PI);
+
+// Of a pixel in window coordinates
+float highlightDimming(vec2 pix) {
+	//float d = max(1.0, length(u_HighlightPos - pix) * 0.01);
+	//float d = length(u_HighlightPos - pix) * 0.01;
+	//float dimming = coef * exp(-d*d * 0.5);
+	float d = length(u_HighlightPos - pix);
+	float dimming = 1.0 - smoothstep(0, 250, d) * 0.75;
+	return max(dimming, 0.1);
+}
\ No newline at end of file
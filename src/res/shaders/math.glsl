@@ -0,0 +1,4 @@
+// Shared constants, included with #include "math.glsl"
+
+const float PI = 3.14159265359;
+const float TAU = 6.28318530718;
\ No newline at end of file
@@ -0,0 +1,35 @@
+// Hash and gradient noise shared by the effects, included with #include "noise.glsl"
+
+#include "math.glsl"
+
+// PCG hash of two seeds, uniform in [0, 1]
+float hash12(uvec2 seeds) {
+	uint seed = (seeds.x * 6967u) ^ (seeds.y * 7919u);
+	uint state = seed * 747796405u + 2891336453u;
+	uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return float((word >> 22u) ^ word) * (1.0 / 4294967295.0);
+}
+
+// Unit gradient of a lattice point
+vec2 latticeGrad(vec2 icoord) {
+	float angle = hash12(floatBitsToUint(icoord)) * TAU;
+	return vec2(cos(angle), sin(angle));
+}
+
+// 2D gradient noise in [0, 1], features about scale pixels apart
+float perlin(vec2 at, float scale) {
+	vec2 coord = at / scale;
+	vec2 icoord = floor(coord);
+	vec2 f = coord - icoord;
+
+	float n0 = dot(latticeGrad(icoord), f);
+	float n1 = dot(latticeGrad(icoord + vec2(1.0, 0.0)), f - vec2(1.0, 0.0));
+	float n2 = dot(latticeGrad(icoord + vec2(0.0, 1.0)), f - vec2(0.0, 1.0));
+	float n3 = dot(latticeGrad(icoord + 1.0), f - 1.0);
+
+	// Same as smoothstep between the lattice points, without its divide and clamp
+	vec2 w = f * f * (3.0 - 2.0 * f);
+	float bottom = mix(n0, n1, w.x);
+	float top = mix(n2, n3, w.x);
+	return (mix(bottom, top, w.y) + 1.0) * 0.5;
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#version 430 core
+
+// Soft round sprite, drawn with additive blending
+
+layout(location = 0) out vec4 color;
+
+in vec4 v_Color;
+
+void main() {
+	vec2 corner = gl_PointCoord * 2.0 - 1.0;
+	float d2 = dot(corner, corner);
+	if (d2 > 1.0)
+		discard;
+	color = vec4(v_Color.rgb, v_Color.a * (1.0 - d2));
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#version 430 core
+
+// A point sprite per particle, the particle buffer is read as vertex attributes
+
+layout(location = 0) in vec2 a_Pos;
+layout(location = 1) in vec3 a_AgeLifeSize;
+layout(location = 2) in vec4 a_Color;
+
+uniform vec2 u_WindDim;
+
+out vec4 v_Color;
+
+void main() {
+	float t = a_AgeLifeSize.x / a_AgeLifeSize.y;
+	v_Color = vec4(a_Color.rgb, a_Color.a * (1.0 - t));
+	gl_PointSize = 2.0 * a_AgeLifeSize.z * (1.0 - 0.5 * t);
+	gl_Position = vec4(a_Pos / u_WindDim * 2.0 - 1.0, 0.0, 1.0);
+}
\ No newline at end of file
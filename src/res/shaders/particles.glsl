@@ -0,0 +1,19 @@
+// Particle storage shared by the particle passes, included with #include "particles.glsl"
+// The layouts and binding points match the buffers of ParticleSystem
+
+struct Particle {
+	vec2 pos;		// Pixels
+	vec2 vel;		// Pixels per second
+	float age;		// Seconds
+	float life;
+	float size;		// Pixels
+	uint color;		// packUnorm4x8
+};
+
+// Live particles in each of the two particle buffers, the passes read from u_Src and write to the other one
+layout(std430, binding = 2) coherent buffer Counters {
+	uint counts[2];
+};
+
+uniform uint u_Src;
+uniform uint u_Capacity;
\ No newline at end of file
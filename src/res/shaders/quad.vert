@@ -0,0 +1,15 @@
+#version 330 core
+
+// Fullscreen or rectangle quad, positions are already in clip space
+
+layout(location = 0) in vec3 a_Position;
+layout(location = 1) in vec2 a_TexCoord;
+
+out vec3 v_Position;
+out vec2 v_TexCoord;
+
+void main() {
+	v_Position = a_Position;
+	v_TexCoord = a_TexCoord;
+	gl_Position = vec4(a_Position, 1.0);
+}
\ No newline at end of file
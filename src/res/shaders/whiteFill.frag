@@ -1,9 +0,0 @@
-#version 330 core
-
-layout(location = 0) out vec4 color;
-
-in vec3 v_Position;
-
-void main() {
-	color = vec4(1.0f, 1.0f, 1.0f, 1.0f);
-}
\ No newline at end of file
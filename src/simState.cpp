@@ -0,0 +1,13 @@
+#include "simState.h"
+
+const SimState::Header* SimState::View(const void* data, size_t size)
+{
+	if (!data || size < sizeof(Header) || reinterpret_cast<uintptr_t>(data) % alignof(Header) != 0)
+		return nullptr;
+	const Header* header = static_cast<const Header*>(data);
+	if (header->magic != s_magic || header->version != s_version || header->headerSize != sizeof(Header))
+		return nullptr;
+	if (size < GetSize(header->dotCount, header->wellCount))
+		return nullptr;
+	return header;
+}
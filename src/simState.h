@@ -0,0 +1,61 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+
+/**
+ * Fixed layout binary snapshot of a Simulation, used as is from memory (a mapped file, a network packet) without parsing.
+ * Layout: SimStateHeader, then dotCount SimStateDots, then wellCount SimStateWells. Everything is little endian
+ * and naturally aligned, bump s_version whenever any of the structs change.
+ */
+namespace SimState {
+	static_assert(std::endian::native == std::endian::little, "Snapshots are read in place, a big endian host would need byte swapping");
+
+	constexpr uint32_t s_magic = 0x54535048;	// "HPST"
+	constexpr uint16_t s_version = 1;
+
+	struct Bar
+	{
+		float yPos;
+		float yVel;
+	};
+
+	struct Header
+	{
+		uint32_t magic;
+		uint16_t version;
+		uint16_t headerSize;
+		uint64_t tick;
+		uint64_t rngState[4];
+		float arenaW, arenaH;
+		Bar leftBar, rightBar;
+		uint32_t dotCount;
+		uint32_t wellCount;
+		uint8_t isTwoPlayer;
+		uint8_t integrator;
+		uint8_t pad[6];
+	};
+
+	struct Dot
+	{
+		float pos[2];
+		float vel[2];
+	};
+
+	struct Well
+	{
+		float pos[2];
+		float mass;
+		float drawRad;
+	};
+
+	static_assert(sizeof(Header) == 88 && alignof(Header) == 8, "Snapshot header layout changed, bump s_version");
+	static_assert(sizeof(Dot) == 16 && sizeof(Well) == 16, "Snapshot entity layout changed, bump s_version");
+
+	inline size_t GetSize(uint32_t dotCount, uint32_t wellCount) { return sizeof(Header) + dotCount * sizeof(Dot) + wellCount * sizeof(Well); }
+
+	/** The header if data holds a complete snapshot of this version, nullptr otherwise. data must be 8 byte aligned. */
+	const Header* View(const void* data, size_t size);
+	inline const Dot* GetDots(const Header* header) { return reinterpret_cast<const Dot*>(header + 1); }
+	inline const Well* GetWells(const Header* header) { return reinterpret_cast<const Well*>(GetDots(header) + header->dotCount); }
+}
@@ -0,0 +1,202 @@
+#include "simulation.h"
+#include "Utils/jobSystem.h"
+#include "simState.h"
+
+Simulation::Simulation(float arenaW, float arenaH, uint64_t seed, Integrator integrator)
+	: m_arenaW(arenaW), m_arenaH(arenaH),
+	m_dots(),
+	m_leftBar(arenaH, true),
+	m_rightBar(arenaH, false),
+	m_wells(),
+	m_isTwoPlayer(true),
+	m_integrator(integrator),
+	m_tick(0),
+	m_rng(seed),
+	m_dotEvents()
+{
+	// Black hole in the middle
+	constexpr float bhMass = 0.03f;
+	constexpr float bhSize = 88.f;
+	m_wells.push_back({ Vec2({ 0.5f * arenaW, 0.5f * arenaH }), bhMass, bhSize });
+}
+
+void Simulation::Serve(float dir)
+{
+	m_dots.clear();
+	m_dots.emplace_back(Vec2({ Projectile::s_rad, m_arenaH * 0.5f }), dir);
+}
+
+void Simulation::Serve()
+{
+	this->Serve(m_rng.UniformF(-1.f, 1.f));
+}
+
+void Simulation::ControlBar(Bar& bar, BarControl ctrl, float dt)
+{
+	switch (ctrl)
+	{
+	case Ctrl_Up:
+		bar.Up(dt);
+		break;
+	case Ctrl_Down:
+		bar.Down(dt);
+		break;
+	default:
+		bar.Brake(dt);
+		break;
+	}
+}
+
+SimEvents Simulation::Step(const TickInput& input, float dt, JobSystem* jobs)
+{
+	ControlBar(m_leftBar, input.left, dt);
+	ControlBar(m_rightBar, m_isTwoPlayer ? input.right : Ctrl_Brake, dt);
+
+	// Dots only read the bars and wells and write themselves, so the batches can run on any thread in any order.
+	// Events are counted per dot and summed afterwards in dot order.
+	const float leftBarX = m_leftBar.GetCollisionX(m_arenaW), rightBarX = m_rightBar.GetCollisionX(m_arenaW);
+	m_dotEvents.assign(m_dots.size(), SimEvents());
+	auto stepDots = [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			Projectile& d = m_dots[i];
+			SimEvents& ev = m_dotEvents[i];
+
+			d.CheckYCollision(m_arenaH);
+
+			ev.barHits += d.CheckLeftCollision(m_leftBar.GetY(), Bar::s_height, leftBarX, m_leftBar.GetYVel(), Bar::s_velTransferCoef);
+			ev.barHits += d.CheckRightCollision(m_rightBar.GetY(), Bar::s_height, rightBarX, m_rightBar.GetYVel(), Bar::s_velTransferCoef, m_isTwoPlayer, m_arenaW);
+
+			// Gravity towards black holes and air res
+			d.Integrate(m_wells, s_airResCoef, dt, m_integrator);
+
+			const Vec2& pos = d.GetPos();
+			ev.leftMiss = pos[0] < -Projectile::s_rad;
+			ev.rightMiss = pos[0] > m_arenaW + Projectile::s_rad;
+			for (const GravityWell& well : m_wells) {
+				const float captureRad = well.drawRad * s_captureFrac;
+				ev.captured |= (pos - well.pos).lengthSqr() < captureRad * captureRad;
+			}
+		}
+	};
+	if (jobs)
+		jobs->ParallelFor(0, m_dots.size(), s_dotsPerJob, stepDots);
+	else
+		stepDots(0, m_dots.size());
+	m_tick++;
+
+	SimEvents events;
+	for (const SimEvents& ev : m_dotEvents) {
+		events.barHits += ev.barHits;
+		events.leftMiss |= ev.leftMiss;
+		events.rightMiss |= ev.rightMiss;
+		events.captured |= ev.captured;
+	}
+	return events;
+}
+
+SimEvents Simulation::StepFrame(const InputFrame& frame, float dt, JobSystem* jobs)
+{
+	if (frame.arenaW > 0 && frame.arenaH > 0)
+		this->SetArenaSize(static_cast<float>(frame.arenaW), static_cast<float>(frame.arenaH));
+
+	// Select 1/2 player mode
+	if (frame.IsDown(In_1))
+		m_isTwoPlayer = false;
+	else if (frame.IsDown(In_2))
+		m_isTwoPlayer = true;
+
+	TickInput input;
+
+	// Player 1 (left) controls, arrows work too in single player
+	if (frame.IsDown(In_W) || (!m_isTwoPlayer && frame.IsDown(In_Up)))
+		input.left = Ctrl_Up;
+	else if (frame.IsDown(In_S) || (!m_isTwoPlayer && frame.IsDown(In_Down)))
+		input.left = Ctrl_Down;
+
+	// Player 2 (right) controls
+	if (m_isTwoPlayer && frame.IsDown(In_Up))
+		input.right = Ctrl_Up;
+	else if (m_isTwoPlayer && frame.IsDown(In_Down))
+		input.right = Ctrl_Down;
+
+	return this->Step(input, dt, jobs);
+}
+
+void Simulation::FillSnapshot(GameSnapshot& snap) const
+{
+	snap.tick = m_tick;
+	snap.dots.resize(m_dots.size());
+	for (size_t i = 0; i < m_dots.size(); i++)
+		snap.dots[i] = m_dots[i].GetState();
+	snap.wells = m_wells;
+	snap.leftBar = m_leftBar.GetState();
+	snap.rightBar = m_rightBar.GetState();
+	snap.isTwoPlayer = m_isTwoPlayer;
+}
+
+void Simulation::SaveState(std::vector<uint64_t>& out) const
+{
+	// Stored in 64 bit words so the buffer is aligned for reading it back in place
+	const size_t size = SimState::GetSize(static_cast<uint32_t>(m_dots.size()), static_cast<uint32_t>(m_wells.size()));
+	out.assign((size + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+
+	SimState::Header* header = reinterpret_cast<SimState::Header*>(out.data());
+	header->magic = SimState::s_magic;
+	header->version = SimState::s_version;
+	header->headerSize = sizeof(SimState::Header);
+	header->tick = m_tick;
+	memcpy(header->rngState, m_rng.GetState().data(), sizeof(header->rngState));
+	header->arenaW = m_arenaW;
+	header->arenaH = m_arenaH;
+	header->leftBar = { m_leftBar.GetY(), m_leftBar.GetYVel() };
+	header->rightBar = { m_rightBar.GetY(), m_rightBar.GetYVel() };
+	header->dotCount = static_cast<uint32_t>(m_dots.size());
+	header->wellCount = static_cast<uint32_t>(m_wells.size());
+	header->isTwoPlayer = m_isTwoPlayer;
+	header->integrator = static_cast<uint8_t>(m_integrator);
+
+	SimState::Dot* dots = reinterpret_cast<SimState::Dot*>(header + 1);
+	for (size_t i = 0; i < m_dots.size(); i++) {
+		const Vec2& pos = m_dots[i].GetPos();
+		const Vec2& vel = m_dots[i].GetVel();
+		dots[i] = { { pos[0], pos[1] }, { vel[0], vel[1] } };
+	}
+	SimState::Well* wells = reinterpret_cast<SimState::Well*>(dots + m_dots.size());
+	for (size_t i = 0; i < m_wells.size(); i++) {
+		const GravityWell& w = m_wells[i];
+		wells[i] = { { w.pos[0], w.pos[1] }, w.mass, w.drawRad };
+	}
+}
+
+bool Simulation::LoadState(const void* data, size_t size)
+{
+	const SimState::Header* header = SimState::View(data, size);
+	// A game always has a dot in play, the renderer and the input code rely on it
+	if (!header || header->integrator >= Integrator_COUNT || header->dotCount == 0) {
+		GAME_ERROR("Not a valid simulation snapshot");
+		return false;
+	}
+
+	m_tick = header->tick;
+	std::array<uint64_t, 4> rngState;
+	memcpy(rngState.data(), header->rngState, sizeof(header->rngState));
+	m_rng.SetState(rngState);
+	m_arenaW = header->arenaW;
+	m_arenaH = header->arenaH;
+	m_leftBar.SetState(header->leftBar.yPos, header->leftBar.yVel);
+	m_rightBar.SetState(header->rightBar.yPos, header->rightBar.yVel);
+	m_isTwoPlayer = header->isTwoPlayer != 0;
+	m_integrator = static_cast<Integrator>(header->integrator);
+
+	const SimState::Dot* dots = SimState::GetDots(header);
+	m_dots.clear();
+	for (uint32_t i = 0; i < header->dotCount; i++)
+		m_dots.emplace_back(DotState{ Vec2(dots[i].pos), Vec2(dots[i].vel) });
+
+	const SimState::Well* wells = SimState::GetWells(header);
+	m_wells.clear();
+	for (uint32_t i = 0; i < header->wellCount; i++)
+		m_wells.push_back({ Vec2(wells[i].pos), wells[i].mass, wells[i].drawRad });
+
+	return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "projectile.h"
+#include "playerBar.h"
+#include "integrator.h"
+#include "gameState.h"
+#include "Utils/random.h"
+
+class JobSystem;
+
+/** What happened during one tick */
+struct SimEvents
+{
+	uint32_t barHits = 0;
+	bool leftMiss = false;		// A dot got past the left bar
+	bool rightMiss = false;
+	bool captured = false;		// A dot reached the singularity of a well
+};
+
+/** The game physics without any rendering or window, usable headless */
+class Simulation
+{
+public:
+	/** All randomness of the simulation comes from the seed */
+	Simulation(float arenaW, float arenaH, uint64_t seed, Integrator integrator = Int_SemiImplicitEuler);
+
+	/** Removes all dots and serves a new one from the left edge at the angle dir (radians) */
+	void Serve(float dir);
+	/** Removes all dots and serves a new one in a random direction like the original serve, within one radian of straight right */
+	void Serve();
+	/** Adds a dot next to the existing ones, for runs with many dots */
+	inline void AddDot(const DotState& dot) { m_dots.emplace_back(dot); }
+
+	SimEvents Step(const TickInput& input, float dt, JobSystem* jobs = nullptr);
+	/** Applies the mode keys and arena size of a raw input frame, then steps with the bar controls it maps to */
+	SimEvents StepFrame(const InputFrame& frame, float dt, JobSystem* jobs = nullptr);
+
+	void FillSnapshot(GameSnapshot& snap) const;
+
+	/** Writes the whole state in the SimState layout, reusing the buffer */
+	void SaveState(std::vector<uint64_t>& out) const;
+	/** Restores from a SimState snapshot in memory, false if it isn't a valid one */
+	bool LoadState(const void* data, size_t size);
+
+	inline void SetArenaSize(float w, float h) { m_arenaW = w; m_arenaH = h; }
+	inline void SetTwoPlayer(bool isTwoPlayer) { m_isTwoPlayer = isTwoPlayer; }
+	inline void SetIntegrator(Integrator integrator) { m_integrator = integrator; }
+
+	inline bool IsTwoPlayer() const { return m_isTwoPlayer; }
+	inline uint64_t GetTick() const { return m_tick; }
+	inline const std::vector<Projectile>& GetDots() const { return m_dots; }
+	inline const Bar& GetLeftBar() const { return m_leftBar; }
+	inline const Bar& GetRightBar() const { return m_rightBar; }
+	inline const std::vector<GravityWell>& GetWells() const { return m_wells; }
+
+private:
+	float m_arenaW, m_arenaH;
+	std::vector<Projectile> m_dots;
+	Bar m_leftBar, m_rightBar;
+	std::vector<GravityWell> m_wells;
+	bool m_isTwoPlayer;
+	Integrator m_integrator;
+	uint64_t m_tick;
+	Rng m_rng;
+	std::vector<SimEvents> m_dotEvents;	// Scratch for the per dot results of a step
+
+	static constexpr float s_airResCoef = 1.f;
+	static constexpr float s_captureFrac = 0.2f;	// Share of the well's drawn radius that is its singularity
+	static constexpr size_t s_dotsPerJob = 64;		// Smaller batches aren't worth handing to another thread
+private:
+	static void ControlBar(Bar& bar, BarControl ctrl, float dt);
+};